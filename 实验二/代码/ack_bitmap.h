@@ -0,0 +1,59 @@
+#ifndef ACK_BITMAP_H
+#define ACK_BITMAP_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// 按包索引 (绝对值,不回绕) 记录是否已被确认的原子位图
+// ACK 线程置位,发送线程读取,都不需要加锁. 位图按块分配,流模式下随发送推进再分配新块,
+// 块在整个传输期间不释放,所以 ACK 线程读到的块指针始终有效.
+class AckBitmap {
+public:
+    static const int CHUNK_SHIFT = 18;                          // 每块 2^18 个包 (32 KB)
+    static const long long CHUNK_BITS = 1LL << CHUNK_SHIFT;
+    static const int CHUNK_WORDS = (int)(CHUNK_BITS / 64);
+    static const int MAX_CHUNKS = 1 << 16;                      // 最多 2^34 个包
+
+    AckBitmap() : dir_(new std::atomic<std::atomic<uint64_t>*>[MAX_CHUNKS]) {
+        for (int i = 0; i < MAX_CHUNKS; i++) dir_[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~AckBitmap() {
+        for (int i = 0; i < MAX_CHUNKS; i++) delete[] dir_[i].load(std::memory_order_relaxed);
+    }
+
+    // 发送线程调用:保证 index 所在的块已分配 (发送一个包之前调用)
+    void ensure(long long index) {
+        long long c = index >> CHUNK_SHIFT;
+        if (c >= MAX_CHUNKS || dir_[c].load(std::memory_order_relaxed)) return;
+        std::atomic<uint64_t>* chunk = new std::atomic<uint64_t>[CHUNK_WORDS];
+        for (int i = 0; i < CHUNK_WORDS; i++) chunk[i].store(0, std::memory_order_relaxed);
+        dir_[c].store(chunk, std::memory_order_release);
+    }
+
+    // ACK 线程调用:置位,返回这个位之前是否为 0 (块未分配时忽略)
+    bool set(long long index) {
+        std::atomic<uint64_t>* w = word(index);
+        if (!w) return false;
+        uint64_t bit = 1ULL << (index & 63);
+        return (w->fetch_or(bit, std::memory_order_release) & bit) == 0;
+    }
+
+    bool test(long long index) const {
+        std::atomic<uint64_t>* w = word(index);
+        return w && (w->load(std::memory_order_acquire) >> (index & 63) & 1);
+    }
+
+private:
+    std::atomic<uint64_t>* word(long long index) const {
+        long long c = index >> CHUNK_SHIFT;
+        if (index < 0 || c >= MAX_CHUNKS) return nullptr;
+        std::atomic<uint64_t>* chunk = dir_[c].load(std::memory_order_acquire);
+        return chunk ? &chunk[(index & (CHUNK_BITS - 1)) >> 6] : nullptr;
+    }
+
+    std::unique_ptr<std::atomic<std::atomic<uint64_t>*>[]> dir_;
+};
+
+#endif // ACK_BITMAP_H
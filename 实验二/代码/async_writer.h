@@ -0,0 +1,170 @@
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <atomic>
+
+// 直接定位的异步写文件器
+// 接收线程把每个数据包按它在文件中的最终偏移交给写线程,写线程用带偏移的 WriteFile (相当于 pwrite) 写到磁盘,
+// 因此乱序到达的包也能立即落盘,磁盘延迟也不会阻塞 ACK 的发送.
+// 偏移连续的包会被合并到同一个块中,写线程空闲时立即取走当前块,磁盘慢时块自然变大,一次写入更多数据.
+struct AsyncWriter {
+    static const size_t CHUNK_SIZE = 256 * 1024;            // 每个合并块的容量
+    static const int CHUNK_COUNT = 16;                      // 块的数量,写线程落后太多时接收线程会等待
+    static const long long PREALLOC_STEP = 64LL << 20;      // 每次预分配 64 MB
+
+    struct Chunk {
+        long long offset;           // 块在文件中的起始偏移
+        size_t len;                 // 块中已有的数据长度
+        std::vector<char> buf;
+    };
+
+    HANDLE file = INVALID_HANDLE_VALUE;
+    long long allocated = 0;        // 已经预分配的文件大小
+    std::vector<Chunk> chunks;
+    std::vector<Chunk*> freeChunks; // 空闲块
+    std::deque<Chunk*> ready;       // 已满或已断开、等待写入的块
+    Chunk* open_ = nullptr;         // 接收线程正在追加的块
+    bool stopping = false;
+    std::atomic<int> freeCount{0};  // 空闲块数,接收线程据此计算通告窗口,不需要加锁
+    std::mutex mtx;
+    std::condition_variable cv;     // 有块可写 / 有空闲块 / 停止
+    std::thread worker;
+
+    long long writeCalls = 0;       // WriteFile 调用次数 (统计合并效果)
+    long long bytesWritten = 0;
+    long long queued = 0;           // 交给写文件器的字节数 (受 mtx 保护)
+    long long flushed = 0;          // 其中已经交给操作系统的字节数 (受 mtx 保护),块按交出的顺序写入
+
+    // keep 为 true 时保留已有的文件内容 (断点续传)
+    bool open(const std::string& filename, bool keep = false) {
+        file = CreateFileA(filename.c_str(), GENERIC_WRITE, 0, NULL, keep ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        if (keep) {
+            LARGE_INTEGER size;
+            if (GetFileSizeEx(file, &size)) {
+                allocated = size.QuadPart;      // 预分配只能扩大文件,不能截掉已有的内容
+            }
+        }
+        chunks.resize(CHUNK_COUNT);
+        for (auto& c : chunks) {
+            c.buf.resize(CHUNK_SIZE);
+            freeChunks.push_back(&c);
+        }
+        freeCount.store(CHUNK_COUNT);
+        worker = std::thread(&AsyncWriter::run, this);
+        return true;
+    }
+
+    // 接收线程调用:把 len 字节数据安排写到文件的 offset 处,数据会被拷贝,调用返回后缓冲区即可复用
+    void write(long long offset, const char* data, int len) {
+        std::unique_lock<std::mutex> lock(mtx);
+        // 与当前块不连续或当前块已满,则把当前块交给写线程
+        if (open_ && (open_->offset + (long long)open_->len != offset || open_->len + len > CHUNK_SIZE)) {
+            ready.push_back(open_);
+            open_ = nullptr;
+            cv.notify_all();
+        }
+        if (!open_) {
+            cv.wait(lock, [this] { return !freeChunks.empty(); });
+            open_ = freeChunks.back();
+            freeChunks.pop_back();
+            freeCount.fetch_sub(1);
+            open_->offset = offset;
+            open_->len = 0;
+        }
+        memcpy(open_->buf.data() + open_->len, data, len);
+        open_->len += len;
+        queued += len;
+        cv.notify_all();
+    }
+
+    // 等待此前交来的数据都写到文件中 (保存断点前调用)
+    void sync() {
+        std::unique_lock<std::mutex> lock(mtx);
+        long long target = queued;
+        cv.wait(lock, [&] { return flushed >= target; });
+    }
+
+    // 写队列还能容纳的字节数 (只计空闲块,正在追加的块剩余的空间不算,偏保守)
+    long long free_bytes() const {
+        return (long long)freeCount.load() * CHUNK_SIZE;
+    }
+
+    // 等待所有数据写完,把文件截断为实际大小并关闭
+    void close(long long finalSize) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        if (worker.joinable()) worker.join();
+
+        if (file != INVALID_HANDLE_VALUE) {
+            set_size(finalSize);            // 去掉预分配多出来的部分
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    void set_size(long long size) {
+        LARGE_INTEGER pos;
+        pos.QuadPart = size;
+        SetFilePointerEx(file, pos, NULL, FILE_BEGIN);
+        SetEndOfFile(file);
+    }
+
+    // 写线程:取出块,必要时先预分配文件空间,再按偏移写入
+    void run() {
+        while (true) {
+            Chunk* c = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [this] { return !ready.empty() || (open_ && open_->len > 0) || stopping; });
+                if (!ready.empty()) {
+                    c = ready.front();
+                    ready.pop_front();
+                } else if (open_ && open_->len > 0) {
+                    c = open_;                  // 写线程空闲,直接取走接收线程正在追加的块
+                    open_ = nullptr;
+                } else {
+                    return;                     // stopping 且没有剩余数据
+                }
+            }
+
+            long long end = c->offset + (long long)c->len;
+            if (end > allocated) {
+                allocated = end + PREALLOC_STEP;
+                set_size(allocated);            // 预分配,避免文件随写入不断增长
+            }
+
+            OVERLAPPED ov;
+            memset(&ov, 0, sizeof(ov));
+            ov.Offset = (DWORD)(c->offset & 0xFFFFFFFF);
+            ov.OffsetHigh = (DWORD)(c->offset >> 32);
+            DWORD written = 0;
+            WriteFile(file, c->buf.data(), (DWORD)c->len, &written, &ov);
+            writeCalls++;
+            bytesWritten += written;
+
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                flushed += (long long)c->len;
+                freeChunks.push_back(c);
+                freeCount.fetch_add(1);
+            }
+            cv.notify_all();
+        }
+    }
+};
+
+#endif // ASYNC_WRITER_H
@@ -0,0 +1,592 @@
+#include <windows.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+// RDT 吞吐量基准测试
+// 在本机依次启动 receiver / (impair_proxy) / sender,遍历 丢包率 x 窗口大小 x 时延 x 文件大小 的每个组合,
+// 每个组合重复若干次,记录有效吞吐量 (Goodput)、线路吞吐量 (含头部和重传)、重传比例和完成时间,
+// 并逐字节比较输出文件与输入文件.
+// 结果写成 CSV (每次运行一行),可选再写一份 JSON;每个组合取中位数作为汇总,
+// 汇总可以保存为基线,之后的运行与基线比较,吞吐量下降超过容差的组合标记为回退.
+//
+// 丢包默认由 sender 的 loss_rate 参数模拟;时延需要 impair_proxy (sender 自带的 delay 是逐包 sleep,不是链路时延),
+// 时延大于 0 或指定 --proxy 时经代理转发,此时丢包也由代理在发送端 -> 接收端方向施加.
+
+// 测试矩阵
+vector<double> lossRates = {0.0};           // 丢包率
+vector<int> windowSizes = {20};             // 窗口大小,同时作为 sender 的 maxWindowSize 和 receiver 的 rcvWindowSize
+vector<double> delays = {0.0};              // 单向时延 (毫秒),由代理施加在两个方向上
+vector<long long> fileSizes = {10LL << 20}; // 文件大小 (字节)
+int repeats = 3;                            // 每个组合重复的次数
+
+bool useProxy = false;                      // 时延为 0 时也经过代理
+string binDir = ".";                        // sender.exe / receiver.exe / impair_proxy.exe 所在目录
+string senderArgs;                          // 追加给 sender 的参数 (如 "--cc bbr --pacing")
+string receiverArgs;                        // 追加给 receiver 的参数
+string proxyArgs;                           // 追加给 impair_proxy 的参数 (如 "--rate 100 --queue 256")
+int basePort = 9100;                        // receiver 端口,代理监听 basePort + PROXY_PORT_OFFSET
+int timeoutSec = 300;                       // 单次传输的超时 (秒)
+string csvPath = "bench_results.csv";
+string jsonPath;
+string baselinePath;                        // 与之比较的基线
+string saveBaselinePath;                    // 把本次汇总保存为基线
+double tolerance = 0.10;                    // 吞吐量低于基线的 (1 - tolerance) 倍视为回退
+
+const int PROXY_PORT_OFFSET = 100;          // 与 --streams 使用的连续端口错开
+const DWORD STARTUP_WAIT_MS = 300;          // 启动 receiver / 代理后等待其绑定端口
+const DWORD RECEIVER_EXIT_WAIT_MS = 5000;   // sender 结束后等待 receiver 写完文件退出
+
+// 单次运行的结果
+struct RunResult {
+    long long size;
+    double loss;
+    int window;
+    double delayMs;
+    int repeat;
+
+    bool completed = false;                 // sender 正常退出并输出了统计
+    bool match = false;                     // 输出文件与输入文件逐字节相同
+    double timeSec = 0;                     // sender 统计的传输时间 (握手完成到全部确认)
+    double wallSec = 0;                     // 从启动 sender 到 receiver 退出的时间
+    double goodput = 0;                     // 有效吞吐量 (MB/s)
+    double wire = 0;                        // 线路吞吐量 (MB/s),含头部和重传
+    long long retransmissions = 0;
+    long long packets = 0;                  // 文件按协商分段大小切成的包数
+    double retransRatio = 0;                // 重传次数 / 包数
+};
+
+// 一个组合的汇总 (各次运行的中位数)
+struct Summary {
+    long long size;
+    double loss;
+    int window;
+    double delayMs;
+    int runs = 0;
+    int ok = 0;                             // 完成且文件一致的次数
+    double goodput = 0;
+    double wire = 0;
+    double timeSec = 0;
+    double retransRatio = 0;
+};
+
+// ---- 子进程 ----
+
+struct Process {
+    PROCESS_INFORMATION pi;
+    bool running = false;
+};
+
+// 启动子进程,标准输出和标准错误重定向到日志文件
+bool start_process(Process& p, const string& cmdline, const string& logPath) {
+    SECURITY_ATTRIBUTES sa;
+    sa.nLength = sizeof(sa);
+    sa.lpSecurityDescriptor = NULL;
+    sa.bInheritHandle = TRUE;               // 子进程要继承日志文件句柄
+    HANDLE log = CreateFileA(logPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &sa, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (log == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    STARTUPINFOA si;
+    memset(&si, 0, sizeof(si));
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    si.hStdOutput = log;
+    si.hStdError = log;
+
+    vector<char> cmd(cmdline.begin(), cmdline.end());
+    cmd.push_back('\0');                    // CreateProcessA 可能修改命令行,需要可写的缓冲区
+    memset(&p.pi, 0, sizeof(p.pi));
+    p.running = CreateProcessA(NULL, cmd.data(), NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &p.pi) != 0;
+    CloseHandle(log);
+    return p.running;
+}
+
+// 等待子进程退出,超时返回 false
+bool wait_process(Process& p, DWORD ms, DWORD* exitCode = NULL) {
+    if (!p.running) {
+        return true;
+    }
+    if (WaitForSingleObject(p.pi.hProcess, ms) != WAIT_OBJECT_0) {
+        return false;
+    }
+    if (exitCode) {
+        GetExitCodeProcess(p.pi.hProcess, exitCode);
+    }
+    CloseHandle(p.pi.hThread);
+    CloseHandle(p.pi.hProcess);
+    p.running = false;
+    return true;
+}
+
+// 结束仍在运行的子进程
+void stop_process(Process& p) {
+    if (!p.running) {
+        return;
+    }
+    TerminateProcess(p.pi.hProcess, 1);
+    wait_process(p, INFINITE);
+}
+
+// ---- 文件 ----
+
+// 生成指定大小的随机输入文件,已存在且大小相同则直接复用
+bool prepare_input(const string& path, long long size) {
+    ifstream in(path, ios::binary | ios::ate);
+    if (in && (long long)in.tellg() == size) {
+        return true;
+    }
+    in.close();
+
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out) {
+        return false;
+    }
+    mt19937 rng(12345);                     // 固定种子,同一大小的输入文件每次都相同
+    vector<uint32_t> block(1 << 16);
+    long long remaining = size;
+    while (remaining > 0) {
+        for (auto& w : block) {
+            w = rng();
+        }
+        long long n = min(remaining, (long long)(block.size() * sizeof(uint32_t)));
+        out.write((const char*)block.data(), n);
+        remaining -= n;
+    }
+    return (bool)out;
+}
+
+// 逐字节比较两个文件
+bool files_equal(const string& a, const string& b) {
+    ifstream fa(a, ios::binary), fb(b, ios::binary);
+    if (!fa || !fb) {
+        return false;
+    }
+    vector<char> ba(1 << 20), bb(1 << 20);
+    while (true) {
+        fa.read(ba.data(), ba.size());
+        fb.read(bb.data(), bb.size());
+        streamsize na = fa.gcount(), nb = fb.gcount();
+        if (na != nb || memcmp(ba.data(), bb.data(), (size_t)na) != 0) {
+            return false;
+        }
+        if (na == 0) {
+            return true;
+        }
+    }
+}
+
+string read_file(const string& path) {
+    ifstream in(path, ios::binary);
+    stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// 在日志中查找以 key 开头的行,解析其后的数值
+bool find_value(const string& log, const string& key, double& value) {
+    size_t pos = 0;
+    while ((pos = log.find(key, pos)) != string::npos) {
+        if (pos == 0 || log[pos - 1] == '\n') {
+            value = atof(log.c_str() + pos + key.size());
+            return true;
+        }
+        pos += key.size();
+    }
+    return false;
+}
+
+// ---- 参数解析 ----
+
+// 解析带 K/M/G 后缀的大小
+long long parse_size(const string& s) {
+    double v = atof(s.c_str());
+    char unit = s.empty() ? 0 : (char)toupper(s.back());
+    if (unit == 'K') v *= 1024;
+    else if (unit == 'M') v *= 1024 * 1024;
+    else if (unit == 'G') v *= 1024.0 * 1024 * 1024;
+    return (long long)v;
+}
+
+// 逗号分隔的列表
+vector<string> split_list(const string& s) {
+    vector<string> items;
+    stringstream ss(s);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+string exe_path(const string& name) {
+    return binDir + "\\" + name + ".exe";
+}
+
+// 组合的标识,用于与基线对应
+string point_key(long long size, double loss, int window, double delayMs) {
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%lld/%g/%d/%g", size, loss, window, delayMs);
+    return buf;
+}
+
+double median(vector<double> v) {
+    if (v.empty()) {
+        return 0;
+    }
+    sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+// ---- 运行 ----
+
+RunResult run_once(long long size, double loss, int window, double delayMs, int repeat) {
+    RunResult r;
+    r.size = size;
+    r.loss = loss;
+    r.window = window;
+    r.delayMs = delayMs;
+    r.repeat = repeat;
+
+    string inPath = "bench_in_" + to_string(size) + ".bin";
+    string outPath = "bench_out.bin";
+    remove(outPath.c_str());
+
+    bool viaProxy = useProxy || delayMs > 0;
+    int targetPort = viaProxy ? basePort + PROXY_PORT_OFFSET : basePort;
+
+    ostringstream rcmd, pcmd, scmd;
+    rcmd << exe_path("receiver") << " " << basePort << " " << outPath << " " << window << " " << receiverArgs;
+    pcmd << exe_path("impair_proxy") << " " << targetPort << " 127.0.0.1 " << basePort
+         << " --fwd-loss " << loss << " --delay " << delayMs << " " << proxyArgs;
+    // 经过代理时丢包由代理施加,sender 的 loss_rate 为 0
+    scmd << exe_path("sender") << " 127.0.0.1 " << targetPort << " " << inPath << " "
+         << (viaProxy ? 0.0 : loss) << " " << window << " 0 " << senderArgs;
+
+    Process receiver, proxy, sender;
+    if (!start_process(receiver, rcmd.str(), "bench_receiver.log")) {
+        cerr << "Failed to start: " << rcmd.str() << endl;
+        return r;
+    }
+    if (viaProxy && !start_process(proxy, pcmd.str(), "bench_proxy.log")) {
+        cerr << "Failed to start: " << pcmd.str() << endl;
+        stop_process(receiver);
+        return r;
+    }
+    Sleep(STARTUP_WAIT_MS);
+
+    auto start = chrono::steady_clock::now();
+    DWORD senderExit = 1;
+    if (!start_process(sender, scmd.str(), "bench_sender.log")) {
+        cerr << "Failed to start: " << scmd.str() << endl;
+    } else if (!wait_process(sender, timeoutSec * 1000, &senderExit)) {
+        cerr << "Sender timed out after " << timeoutSec << " s." << endl;
+        stop_process(sender);
+    }
+    if (!wait_process(receiver, RECEIVER_EXIT_WAIT_MS)) {
+        stop_process(receiver);
+    }
+    r.wallSec = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count() / 1000000.0;
+    stop_process(proxy);                    // 代理不会自行退出
+
+    string log = read_file("bench_sender.log");
+    double timeSec = 0, retrans = 0, wireBytes = 0, segSize = 0;
+    size_t segPos = log.find("Segment size: ");
+    if (segPos != string::npos) {
+        segSize = atof(log.c_str() + segPos + 14);
+    }
+    r.completed = senderExit == 0 && find_value(log, "Time: ", timeSec) && find_value(log, "Retransmissions: ", retrans);
+    find_value(log, "Wire: ", wireBytes);
+    r.match = r.completed && files_equal(inPath, outPath);
+
+    if (r.completed && timeSec > 0) {
+        r.timeSec = timeSec;
+        r.goodput = size / 1024.0 / 1024.0 / timeSec;
+        r.wire = wireBytes / 1024.0 / 1024.0 / timeSec;
+        r.retransmissions = (long long)retrans;
+        r.packets = segSize > 0 ? (long long)((size + segSize - 1) / segSize) : 0;
+        r.retransRatio = r.packets > 0 ? (double)r.retransmissions / r.packets : 0;
+    }
+    return r;
+}
+
+vector<Summary> summarize(const vector<RunResult>& results) {
+    vector<Summary> summaries;
+    map<string, vector<const RunResult*>> groups;
+    vector<string> order;
+    for (const auto& r : results) {
+        string key = point_key(r.size, r.loss, r.window, r.delayMs);
+        if (groups.find(key) == groups.end()) {
+            order.push_back(key);
+        }
+        groups[key].push_back(&r);
+    }
+    for (const auto& key : order) {
+        const auto& runs = groups[key];
+        Summary s;
+        s.size = runs[0]->size;
+        s.loss = runs[0]->loss;
+        s.window = runs[0]->window;
+        s.delayMs = runs[0]->delayMs;
+        s.runs = (int)runs.size();
+        vector<double> goodput, wire, timeSec, ratio;
+        for (const RunResult* r : runs) {
+            if (!r->match) {
+                continue;                   // 失败的运行不计入中位数
+            }
+            s.ok++;
+            goodput.push_back(r->goodput);
+            wire.push_back(r->wire);
+            timeSec.push_back(r->timeSec);
+            ratio.push_back(r->retransRatio);
+        }
+        s.goodput = median(goodput);
+        s.wire = median(wire);
+        s.timeSec = median(timeSec);
+        s.retransRatio = median(ratio);
+        summaries.push_back(s);
+    }
+    return summaries;
+}
+
+// ---- 输出 ----
+
+bool write_csv(const string& path, const vector<RunResult>& results) {
+    ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << "size_bytes,loss,window,delay_ms,repeat,completed,match,time_s,wall_s,goodput_mbps,wire_mbps,retransmissions,packets,retrans_ratio\n";
+    for (const auto& r : results) {
+        out << r.size << "," << r.loss << "," << r.window << "," << r.delayMs << "," << r.repeat << ","
+            << r.completed << "," << r.match << "," << r.timeSec << "," << r.wallSec << ","
+            << r.goodput << "," << r.wire << "," << r.retransmissions << "," << r.packets << "," << r.retransRatio << "\n";
+    }
+    return (bool)out;
+}
+
+bool write_json(const string& path, const vector<RunResult>& results, const vector<Summary>& summaries) {
+    ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << "{\n  \"runs\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& r = results[i];
+        out << "    {\"size_bytes\": " << r.size << ", \"loss\": " << r.loss << ", \"window\": " << r.window
+            << ", \"delay_ms\": " << r.delayMs << ", \"repeat\": " << r.repeat
+            << ", \"completed\": " << (r.completed ? "true" : "false") << ", \"match\": " << (r.match ? "true" : "false")
+            << ", \"time_s\": " << r.timeSec << ", \"wall_s\": " << r.wallSec
+            << ", \"goodput_mbps\": " << r.goodput << ", \"wire_mbps\": " << r.wire
+            << ", \"retransmissions\": " << r.retransmissions << ", \"packets\": " << r.packets
+            << ", \"retrans_ratio\": " << r.retransRatio << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n  \"summary\": [\n";
+    for (size_t i = 0; i < summaries.size(); i++) {
+        const auto& s = summaries[i];
+        out << "    {\"size_bytes\": " << s.size << ", \"loss\": " << s.loss << ", \"window\": " << s.window
+            << ", \"delay_ms\": " << s.delayMs << ", \"runs\": " << s.runs << ", \"ok\": " << s.ok
+            << ", \"goodput_mbps\": " << s.goodput << ", \"wire_mbps\": " << s.wire
+            << ", \"time_s\": " << s.timeSec << ", \"retrans_ratio\": " << s.retransRatio << "}"
+            << (i + 1 < summaries.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return (bool)out;
+}
+
+// 基线文件:每个组合一行的汇总 CSV
+bool save_baseline(const string& path, const vector<Summary>& summaries) {
+    ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << "size_bytes,loss,window,delay_ms,runs,ok,goodput_mbps,wire_mbps,time_s,retrans_ratio\n";
+    for (const auto& s : summaries) {
+        out << s.size << "," << s.loss << "," << s.window << "," << s.delayMs << "," << s.runs << "," << s.ok << ","
+            << s.goodput << "," << s.wire << "," << s.timeSec << "," << s.retransRatio << "\n";
+    }
+    return (bool)out;
+}
+
+// 读取基线,返回 组合 -> 吞吐量中位数
+bool load_baseline(const string& path, map<string, double>& baseline) {
+    ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    string line;
+    getline(in, line);                      // 表头
+    while (getline(in, line)) {
+        long long size;
+        double loss, delayMs, goodput;
+        int window, runs, ok;
+        if (sscanf(line.c_str(), "%lld,%lf,%d,%lf,%d,%d,%lf", &size, &loss, &window, &delayMs, &runs, &ok, &goodput) == 7) {
+            baseline[point_key(size, loss, window, delayMs)] = goodput;
+        }
+    }
+    return true;
+}
+
+void print_usage(const char* prog) {
+    cout << "Usage: " << prog << " [--loss list] [--window list] [--delay list] [--size list] [--repeat n] [--proxy]" << endl;
+    cout << "       [--bin dir] [--port n] [--timeout s] [--sender-args str] [--receiver-args str] [--proxy-args str]" << endl;
+    cout << "       [--csv file] [--json file] [--baseline file] [--save-baseline file] [--tolerance fraction]" << endl;
+    cout << "  Lists are comma separated, sizes accept K/M/G suffixes. Delay is one-way (ms) and runs through impair_proxy." << endl;
+    cout << "Example: " << prog << " --loss 0,0.01,0.05 --window 20,64 --delay 0,10 --size 1M,16M --repeat 3 --baseline base.csv" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        string opt = argv[i];
+        if (i + 1 >= argc && opt != "--proxy") {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (opt == "--loss") {
+            lossRates.clear();
+            for (auto& v : split_list(argv[++i])) lossRates.push_back(atof(v.c_str()));
+        } else if (opt == "--window") {
+            windowSizes.clear();
+            for (auto& v : split_list(argv[++i])) windowSizes.push_back(max(1, atoi(v.c_str())));
+        } else if (opt == "--delay") {
+            delays.clear();
+            for (auto& v : split_list(argv[++i])) delays.push_back(atof(v.c_str()));
+        } else if (opt == "--size") {
+            fileSizes.clear();
+            for (auto& v : split_list(argv[++i])) fileSizes.push_back(parse_size(v));
+        } else if (opt == "--repeat") {
+            repeats = max(1, atoi(argv[++i]));
+        } else if (opt == "--proxy") {
+            useProxy = true;
+        } else if (opt == "--bin") {
+            binDir = argv[++i];
+        } else if (opt == "--port") {
+            basePort = atoi(argv[++i]);
+        } else if (opt == "--timeout") {
+            timeoutSec = max(1, atoi(argv[++i]));
+        } else if (opt == "--sender-args") {
+            senderArgs = argv[++i];
+        } else if (opt == "--receiver-args") {
+            receiverArgs = argv[++i];
+        } else if (opt == "--proxy-args") {
+            proxyArgs = argv[++i];
+        } else if (opt == "--csv") {
+            csvPath = argv[++i];
+        } else if (opt == "--json") {
+            jsonPath = argv[++i];
+        } else if (opt == "--baseline") {
+            baselinePath = argv[++i];
+        } else if (opt == "--save-baseline") {
+            saveBaselinePath = argv[++i];
+        } else if (opt == "--tolerance") {
+            tolerance = atof(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (lossRates.empty() || windowSizes.empty() || delays.empty() || fileSizes.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    map<string, double> baseline;
+    if (!baselinePath.empty() && !load_baseline(baselinePath, baseline)) {
+        cerr << "Cannot read baseline " << baselinePath << endl;
+        return 1;
+    }
+
+    for (long long size : fileSizes) {
+        if (!prepare_input("bench_in_" + to_string(size) + ".bin", size)) {
+            cerr << "Cannot create input file of " << size << " bytes." << endl;
+            return 1;
+        }
+    }
+
+    int total = (int)(fileSizes.size() * lossRates.size() * windowSizes.size() * delays.size()) * repeats;
+    cout << "Running " << total << " transfers." << endl;
+
+    vector<RunResult> results;
+    cout << fixed << setprecision(3);
+    for (long long size : fileSizes) {
+        for (double loss : lossRates) {
+            for (int window : windowSizes) {
+                for (double delayMs : delays) {
+                    for (int rep = 0; rep < repeats; rep++) {
+                        RunResult r = run_once(size, loss, window, delayMs, rep);
+                        results.push_back(r);
+                        cout << "[" << results.size() << "/" << total << "] size " << size << ", loss " << loss
+                             << ", window " << window << ", delay " << delayMs << " ms, run " << rep + 1 << ": ";
+                        if (!r.completed) {
+                            cout << "FAILED (see bench_sender.log)" << endl;
+                        } else if (!r.match) {
+                            cout << "MISMATCH (output differs from input)" << endl;
+                        } else {
+                            cout << r.timeSec << " s, goodput " << r.goodput << " MB/s, wire " << r.wire
+                                 << " MB/s, retrans ratio " << r.retransRatio << endl;
+                        }
+                        if (!write_csv(csvPath, results)) {       // 每次运行后都写一遍,中途中断也能保留已有结果
+                            cerr << "Cannot write " << csvPath << endl;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    vector<Summary> summaries = summarize(results);
+    bool failed = false;
+    int regressions = 0;
+    cout << endl << "Summary (median of successful runs):" << endl;
+    for (const auto& s : summaries) {
+        cout << "size " << s.size << ", loss " << s.loss << ", window " << s.window << ", delay " << s.delayMs << " ms: "
+             << s.ok << "/" << s.runs << " ok, goodput " << s.goodput << " MB/s, wire " << s.wire << " MB/s, time "
+             << s.timeSec << " s, retrans ratio " << s.retransRatio;
+        if (s.ok < s.runs) {
+            failed = true;
+        }
+        auto it = baseline.find(point_key(s.size, s.loss, s.window, s.delayMs));
+        if (it != baseline.end() && it->second > 0) {
+            double change = (s.goodput - it->second) / it->second;
+            cout << ", baseline " << it->second << " MB/s (" << showpos << change * 100 << noshowpos << "%)";
+            if (s.ok == 0 || change < -tolerance) {
+                cout << " REGRESSION";
+                regressions++;
+            }
+        }
+        cout << endl;
+    }
+
+    if (!jsonPath.empty() && !write_json(jsonPath, results, summaries)) {
+        cerr << "Cannot write " << jsonPath << endl;
+    }
+    if (!saveBaselinePath.empty()) {
+        if (save_baseline(saveBaselinePath, summaries)) {
+            cout << "Baseline saved to " << saveBaselinePath << endl;
+        } else {
+            cerr << "Cannot write " << saveBaselinePath << endl;
+        }
+    }
+    cout << "Results written to " << csvPath << (jsonPath.empty() ? "" : " and " + jsonPath) << endl;
+    if (!baseline.empty()) {
+        cout << regressions << " regression(s) against " << baselinePath
+             << " (tolerance " << tolerance * 100 << "%)" << endl;
+    }
+    return (failed || regressions > 0) ? 1 : 0;
+}
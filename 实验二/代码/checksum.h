@@ -0,0 +1,127 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstdint>
+#include <cstring>                  // memcpy()
+
+// 反码求和(ones' complement sum)的几种实现
+// 所有实现都只返回 32 位的累加和(尚未折叠、尚未取反),由 calculate_checksum() 统一折叠并取反,
+// 这样标量版本与 SIMD 版本得到的结果可以逐位比较.
+// 累加按本机字节序的 uint16_t 进行,奇数长度时最后 1 个字节作为低字节单独加上,与原来的标量循环保持一致.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHECKSUM_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+// 标量版本 (原实现,也是不支持 SIMD 时的回退版本)
+inline uint32_t checksum_sum_scalar(const void* buf, int size) {
+    const uint8_t* p = (const uint8_t*)buf;
+    uint32_t sum = 0;
+    while (size > 1) {
+        uint16_t word;
+        memcpy(&word, p, 2);    // Packet 是 1 字节对齐的,用 memcpy 避免非对齐访问
+        sum += word;            // 每次加2字节(uint16_t)
+        p += 2;
+        size -= 2;              // 减少已处理的字节数
+    }
+    if (size > 0) {
+        sum += *p;              // 处理剩余的1个单字节
+    }
+    return sum;
+}
+
+// 把 64 位累加和折叠回 32 位 (2^32 ≡ 1 mod 0xFFFF,所以折叠不改变最终的 16 位校验和)
+inline uint32_t checksum_fold64(uint64_t sum) {
+    while (sum >> 32) {
+        sum = (sum & 0xFFFFFFFFULL) + (sum >> 32);
+    }
+    return (uint32_t)sum;
+}
+
+#ifdef CHECKSUM_HAVE_X86
+// SSE2 版本:每次处理 16 字节 (8 个 uint16_t)
+// 先把 16 位的字零扩展成 32 位,再按 32 位通道累加,单个通道在 64 KB 以内不会溢出
+__attribute__((target("sse2")))
+inline uint32_t checksum_sum_sse2(const void* buf, int size) {
+    const uint8_t* p = (const uint8_t*)buf;
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+
+    while (size >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        acc0 = _mm_add_epi32(acc0, _mm_unpacklo_epi16(v, zero));   // 低 4 个字
+        acc1 = _mm_add_epi32(acc1, _mm_unpackhi_epi16(v, zero));   // 高 4 个字
+        p += 16;
+        size -= 16;
+    }
+
+    uint32_t lanes[8];
+    _mm_storeu_si128((__m128i*)lanes, acc0);
+    _mm_storeu_si128((__m128i*)(lanes + 4), acc1);
+    uint64_t sum = 0;
+    for (int i = 0; i < 8; i++) sum += lanes[i];
+
+    sum += checksum_sum_scalar(p, size);   // 不足 16 字节的尾部交给标量版本
+    return checksum_fold64(sum);
+}
+
+// AVX2 版本:每次处理 32 字节 (16 个 uint16_t)
+__attribute__((target("avx2")))
+inline uint32_t checksum_sum_avx2(const void* buf, int size) {
+    const uint8_t* p = (const uint8_t*)buf;
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+
+    while (size >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        // unpack 在每个 128 位通道内进行,字的顺序会被打乱,但求和与顺序无关
+        acc0 = _mm256_add_epi32(acc0, _mm256_unpacklo_epi16(v, zero));
+        acc1 = _mm256_add_epi32(acc1, _mm256_unpackhi_epi16(v, zero));
+        p += 32;
+        size -= 32;
+    }
+
+    uint32_t lanes[16];
+    _mm256_storeu_si256((__m256i*)lanes, acc0);
+    _mm256_storeu_si256((__m256i*)(lanes + 8), acc1);
+    uint64_t sum = 0;
+    for (int i = 0; i < 16; i++) sum += lanes[i];
+
+    sum += checksum_sum_sse2(p, size);     // 尾部先交给 SSE2,再交给标量
+    return checksum_fold64(sum);
+}
+#endif // CHECKSUM_HAVE_X86
+
+typedef uint32_t (*ChecksumSumFn)(const void* buf, int size);
+
+// 运行时检测 CPU 支持的指令集,选出最快的实现 (只在第一次调用时检测)
+inline ChecksumSumFn select_checksum_sum(const char** name = nullptr) {
+    static ChecksumSumFn fn = nullptr;
+    static const char* fnName = "scalar";
+    if (!fn) {
+        fn = checksum_sum_scalar;
+#ifdef CHECKSUM_HAVE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            fn = checksum_sum_avx2;
+            fnName = "avx2";
+        } else if (__builtin_cpu_supports("sse2")) {
+            fn = checksum_sum_sse2;
+            fnName = "sse2";
+        }
+#endif
+    }
+    if (name) *name = fnName;
+    return fn;
+}
+
+// 对 size 字节求反码和,自动使用当前 CPU 上最快的实现
+inline uint32_t checksum_sum(const void* buf, int size) {
+    static const ChecksumSumFn fn = select_checksum_sum();
+    return fn(buf, size);
+}
+
+#endif // CHECKSUM_H
@@ -0,0 +1,99 @@
+#include "rdt.h"
+#include <cstdlib>
+#include <iomanip>
+
+using namespace std;
+
+// 校验和微基准测试
+// 对 0 ~ MSS 的每一种数据长度,分别测量标量/SSE2/AVX2 实现每个包的耗时 (ns/packet),
+// 并检查每种实现得到的校验和都与标量版本完全一致.
+
+struct ChecksumImpl {
+    const char* name;
+    ChecksumSumFn fn;
+};
+
+// 与 calculate_checksum() 相同的折叠与取反,用于比较各实现的最终结果
+static uint16_t finish_checksum(uint32_t sum) {
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)(~sum);
+}
+
+volatile uint32_t sink;     // 防止编译器把被测循环整个优化掉
+
+static double measure_ns(ChecksumSumFn fn, const Packet& pkt, int size, int iterations) {
+    auto t0 = chrono::steady_clock::now();
+    uint32_t acc = 0;
+    for (int i = 0; i < iterations; i++) {
+        acc += fn(&pkt, size);
+    }
+    auto t1 = chrono::steady_clock::now();
+    sink = acc;
+    return chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count() / (double)iterations;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = 20000;                 // 每个长度每种实现的重复次数
+    if (argc >= 2) {
+        iterations = atoi(argv[1]);
+    }
+
+    vector<ChecksumImpl> impls;
+    impls.push_back({"scalar", checksum_sum_scalar});
+#ifdef CHECKSUM_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) impls.push_back({"sse2", checksum_sum_sse2});
+    if (__builtin_cpu_supports("avx2")) impls.push_back({"avx2", checksum_sum_avx2});
+#endif
+
+    const char* selected = nullptr;
+    select_checksum_sum(&selected);
+    cout << "Runtime selected implementation: " << selected << endl;
+    cout << "Iterations per length: " << iterations << endl;
+
+    srand(12345);
+    Packet pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    for (int i = 0; i < MSS; i++) {
+        pkt.data[i] = (char)(rand() & 0xFF);
+    }
+
+    cout << setw(6) << "len";
+    for (const auto& impl : impls) cout << setw(12) << impl.name;
+    cout << "   (ns/packet)" << endl;
+
+    int mismatches = 0;
+    for (int len = 0; len <= MSS; len++) {
+        pkt.header.seq = len;
+        pkt.header.length = len;
+        int size = sizeof(PacketHeader) + len;
+
+        // 正确性检查: 分别用全 0xFF 和随机数据检查,全 0xFF 是进位最多的情况
+        uint16_t expected = finish_checksum(checksum_sum_scalar(&pkt, size));
+        Packet ones;
+        memset(&ones, 0xFF, sizeof(ones));
+        uint16_t expectedOnes = finish_checksum(checksum_sum_scalar(&ones, size));
+        for (const auto& impl : impls) {
+            if (finish_checksum(impl.fn(&pkt, size)) != expected ||
+                finish_checksum(impl.fn(&ones, size)) != expectedOnes) {
+                cout << "[Mismatch] " << impl.name << " len " << len << endl;
+                mismatches++;
+            }
+        }
+
+        cout << setw(6) << len << fixed << setprecision(2);
+        for (const auto& impl : impls) {
+            cout << setw(12) << measure_ns(impl.fn, pkt, size, iterations);
+        }
+        cout << endl;
+    }
+
+    if (mismatches > 0) {
+        cout << "FAILED: " << mismatches << " mismatches." << endl;
+        return 1;
+    }
+    cout << "All implementations match scalar for len 0.." << MSS << "." << endl;
+    return 0;
+}
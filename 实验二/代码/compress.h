@@ -0,0 +1,344 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// 数据压缩 (握手时协商,见 FLAG_COMPRESS)
+// 发送端把原始数据按 COMPRESS_BLOCK 字节分块,由多个工作线程并行压缩,按块的顺序拼成一条字节流,
+// 再像流模式一样逐段切成满的分段发送;接收端按序把字节流拆回各块,解压后写入输出文件.
+// 每块前有一个 8 字节的帧头;压缩后不变小的块原样存放 (帧头中标记),不可压缩的数据只多出帧头的开销.
+// 压缩算法是 LZ4 风格的字节对齐 LZ77:没有熵编码,压缩和解压都只做拷贝和比较,速度远高于网络.
+
+const int COMPRESS_BLOCK = 64 * 1024;       // 每块的原始数据大小 (最后一块可能更小),匹配距离不超过 64 KB 正好用 2 字节表示
+const uint32_t COMPRESS_STORED = 0x80000000u;   // 帧头 length 的最高位:该块原样存放
+
+#pragma pack(push, 1)
+struct CompressFrame {
+    uint32_t rawLength;     // 原始数据长度
+    uint32_t length;        // 帧头之后的数据长度,最高位为 COMPRESS_STORED 时表示原样存放
+};
+#pragma pack(pop)
+
+// ---------------- 块压缩 ----------------
+// 每个序列:标记字节 (高 4 位字面量长度,低 4 位匹配长度减 4,等于 15 时后面跟扩展字节,每个 255 表示继续),
+// 字面量,2 字节匹配距离 (小端),匹配长度的扩展字节. 最后一个序列只有字面量,输入在字面量之后结束.
+
+const int LZ_MIN_MATCH = 4;
+const int LZ_HASH_BITS = 14;
+
+inline uint32_t lz_read32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint32_t lz_hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// 写出长度的扩展字节
+inline bool lz_put_length(unsigned char*& op, const unsigned char* oend, int len) {
+    while (len >= 255) {
+        if (op >= oend) return false;
+        *op++ = 255;
+        len -= 255;
+    }
+    if (op >= oend) return false;
+    *op++ = (unsigned char)len;
+    return true;
+}
+
+// 写出一个序列:literalLen 个字面量,之后是距离为 offset、长度为 matchLen 的匹配 (matchLen 为 0 表示最后一个序列)
+inline bool lz_put_sequence(unsigned char*& op, const unsigned char* oend, const unsigned char* literals,
+                            int literalLen, int offset, int matchLen) {
+    if (op >= oend) return false;
+    unsigned char* token = op++;
+    *token = (unsigned char)(std::min(literalLen, 15) << 4);
+    if (literalLen >= 15 && !lz_put_length(op, oend, literalLen - 15)) return false;
+    if (oend - op < literalLen) return false;
+    memcpy(op, literals, literalLen);
+    op += literalLen;
+    if (matchLen == 0) return true;
+    if (oend - op < 2) return false;
+    *op++ = (unsigned char)(offset & 0xFF);
+    *op++ = (unsigned char)(offset >> 8);
+    int m = matchLen - LZ_MIN_MATCH;
+    *token |= (unsigned char)std::min(m, 15);
+    return m < 15 || lz_put_length(op, oend, m - 15);
+}
+
+// 压缩 src[0, n) 到 dst,返回压缩后的长度;结果放不进 cap 字节 (数据不可压缩) 时返回 0
+// table 为 2^LZ_HASH_BITS 个元素的散列表,由调用者提供以免每块都分配
+inline int lz_compress(const char* src, int n, char* dst, int cap, std::vector<int>& table) {
+    table.assign(1 << LZ_HASH_BITS, -1);
+    const unsigned char* base = (const unsigned char*)src;
+    const unsigned char* iend = base + n;
+    const unsigned char* anchor = base;     // 还没有输出的字面量的起点
+    const unsigned char* p = base;
+    unsigned char* op = (unsigned char*)dst;
+    const unsigned char* oend = op + cap;
+
+    while (p + LZ_MIN_MATCH <= iend) {
+        uint32_t v = lz_read32(p);
+        uint32_t h = lz_hash(v);
+        int cand = table[h];
+        table[h] = (int)(p - base);
+        if (cand >= 0 && (p - base) - cand <= 0xFFFF && lz_read32(base + cand) == v) {
+            const unsigned char* m = base + cand;
+            int len = LZ_MIN_MATCH;
+            while (p + len < iend && m[len] == p[len]) len++;
+            if (!lz_put_sequence(op, oend, anchor, (int)(p - anchor), (int)(p - m), len)) return 0;
+            p += len;
+            anchor = p;
+        } else {
+            p += 1 + ((p - anchor) >> 6);   // 连续找不到匹配时加大步长,不可压缩的数据很快扫过
+        }
+    }
+    if (!lz_put_sequence(op, oend, anchor, (int)(iend - anchor), 0, 0)) return 0;
+    return (int)(op - (unsigned char*)dst);
+}
+
+// 读取长度的扩展字节
+inline bool lz_get_length(const unsigned char*& ip, const unsigned char* iend, int& len) {
+    unsigned char b;
+    do {
+        if (ip >= iend) return false;
+        b = *ip++;
+        len += b;
+    } while (b == 255);
+    return true;
+}
+
+// 解压 src[0, n) 到 dst,解压结果必须正好是 rawLen 字节,数据损坏时返回 false (不会越界读写)
+inline bool lz_decompress(const char* src, int n, char* dst, int rawLen) {
+    const unsigned char* ip = (const unsigned char*)src;
+    const unsigned char* iend = ip + n;
+    unsigned char* op = (unsigned char*)dst;
+    unsigned char* ostart = op;
+    unsigned char* oend = op + rawLen;
+    while (ip < iend) {
+        unsigned char token = *ip++;
+        int literalLen = token >> 4;
+        if (literalLen == 15 && !lz_get_length(ip, iend, literalLen)) return false;
+        if (iend - ip < literalLen || oend - op < literalLen) return false;
+        memcpy(op, ip, literalLen);
+        ip += literalLen;
+        op += literalLen;
+        if (ip == iend) break;                  // 最后一个序列
+        if (iend - ip < 2) return false;
+        int offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        int matchLen = token & 15;
+        if (matchLen == 15 && !lz_get_length(ip, iend, matchLen)) return false;
+        matchLen += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op - ostart || oend - op < matchLen) return false;
+        const unsigned char* m = op - offset;
+        for (int i = 0; i < matchLen; i++) op[i] = m[i];    // 距离可能小于长度 (重复模式),只能逐字节拷贝
+        op += matchLen;
+    }
+    return op == oend;
+}
+
+// ---------------- 发送端:并行压缩流水线 ----------------
+// 工作线程按顺序从数据源读入一块 (读取在锁内进行,保证块的顺序),在锁外压缩;
+// 消费者 (发送端的读线程) 用 read() 按块的顺序取出帧,像 fread 一样除最后一次外总是读满.
+// 槽位数为工作线程数的两倍,消费者跟不上时工作线程等待,内存占用固定.
+class CompressPipeline {
+public:
+    typedef std::function<size_t(char*, size_t)> Source;  // 读原始数据,除数据结束外总是读满,返回 0 表示结束
+
+    long long rawBytes = 0;         // 读入的原始字节数
+    long long outBytes = 0;         // 输出的字节数 (含帧头)
+    long long blocks = 0;           // 块数
+    long long storedBlocks = 0;     // 压缩后不变小、原样存放的块数
+
+    void start(Source src, int workerCount) {
+        source = src;
+        slots.resize(workerCount * 2);
+        for (Slot& s : slots) {
+            s.raw.resize(COMPRESS_BLOCK);
+            s.out.resize(sizeof(CompressFrame) + COMPRESS_BLOCK);
+        }
+        for (int i = 0; i < workerCount; i++) {
+            workers.push_back(std::thread(&CompressPipeline::work, this));
+        }
+    }
+
+    size_t read(char* buf, size_t n) {
+        size_t done = 0;
+        while (done < n) {
+            Slot* s;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [this] { return finished() || slots[consumed % slots.size()].ready; });
+                if (finished()) break;
+                s = &slots[consumed % slots.size()];
+            }
+            size_t k = std::min(n - done, (size_t)(s->outLen - outPos));
+            memcpy(buf + done, s->out.data() + outPos, k);
+            outPos += (int)k;
+            done += k;
+            if (outPos == s->outLen) {
+                std::lock_guard<std::mutex> lock(mtx);
+                s->ready = false;
+                consumed++;
+                outPos = 0;
+                cv.notify_all();
+            }
+        }
+        return done;
+    }
+
+    // 等待工作线程退出 (提前结束时让它们不再读入新块)
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            eof = true;
+        }
+        cv.notify_all();
+        for (std::thread& t : workers) t.join();
+        workers.clear();
+    }
+
+private:
+    struct Slot {
+        std::vector<char> raw;
+        std::vector<char> out;      // 帧头 + 压缩 (或原样存放) 的数据
+        int outLen = 0;
+        bool ready = false;
+    };
+
+    Source source;
+    std::vector<Slot> slots;
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    std::condition_variable cv;
+    long long nextRead = 0;         // 下一个要读入的块
+    long long consumed = 0;         // 消费者已取完的块
+    long long total = -1;           // 总块数,读到数据结束前为 -1
+    bool eof = false;
+    int outPos = 0;                 // 消费者在当前块中读到的位置
+
+    bool finished() const { return total >= 0 && consumed >= total; }
+
+    void work() {
+        std::vector<int> table;
+        while (true) {
+            Slot* s;
+            int rawLen;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [this] { return eof || nextRead < consumed + (long long)slots.size(); });
+                if (eof) return;
+                long long index = nextRead++;
+                s = &slots[index % slots.size()];
+                rawLen = (int)source(s->raw.data(), COMPRESS_BLOCK);
+                if (rawLen == 0) {
+                    eof = true;
+                    total = index;
+                    cv.notify_all();
+                    return;
+                }
+                rawBytes += rawLen;
+            }
+
+            CompressFrame frame;
+            frame.rawLength = (uint32_t)rawLen;
+            char* payload = s->out.data() + sizeof(CompressFrame);
+            int len = lz_compress(s->raw.data(), rawLen, payload, rawLen - 1, table);
+            bool stored = len == 0;
+            if (stored) {
+                memcpy(payload, s->raw.data(), rawLen);
+                len = rawLen;
+            }
+            frame.length = (uint32_t)len | (stored ? COMPRESS_STORED : 0);
+            memcpy(s->out.data(), &frame, sizeof(frame));
+
+            std::lock_guard<std::mutex> lock(mtx);
+            s->outLen = (int)sizeof(CompressFrame) + len;
+            s->ready = true;
+            outBytes += s->outLen;
+            blocks++;
+            if (stored) storedBlocks++;
+            cv.notify_all();
+        }
+    }
+};
+
+// ---------------- 接收端:按序解压字节流 ----------------
+// feed() 按序送入收到的数据,凑齐一帧就解压并交给 sink(data, len);数据损坏后不再输出
+class StreamDecompressor {
+public:
+    long long inBytes = 0;          // 送入的字节数 (压缩后的字节流)
+    long long rawBytes = 0;         // 解压出的字节数
+    bool failed = false;
+
+    template <class Sink>
+    void feed(const char* data, int len, Sink sink) {
+        inBytes += len;
+        while (len > 0 && !failed) {
+            // 先凑齐帧头,再凑齐整帧
+            size_t need = sizeof(CompressFrame);
+            if (pending.size() >= sizeof(CompressFrame)) {
+                need += payload_length();
+            }
+            int k = (int)std::min((size_t)len, need - pending.size());
+            pending.insert(pending.end(), data, data + k);
+            data += k;
+            len -= k;
+            if (pending.size() == sizeof(CompressFrame)) {
+                const CompressFrame* f = (const CompressFrame*)pending.data();
+                if (f->rawLength == 0 || f->rawLength > (uint32_t)COMPRESS_BLOCK || payload_length() > (size_t)COMPRESS_BLOCK) {
+                    failed = true;
+                    return;
+                }
+            }
+            if (pending.size() >= sizeof(CompressFrame) && pending.size() == sizeof(CompressFrame) + payload_length()) {
+                decode(sink);
+            }
+        }
+    }
+
+    // 字节流在一帧的中间结束也算损坏
+    bool complete() const { return !failed && pending.empty(); }
+
+private:
+    std::vector<char> pending;      // 还没凑齐的帧
+    std::vector<char> out = std::vector<char>(COMPRESS_BLOCK);
+
+    size_t payload_length() const {
+        return ((const CompressFrame*)pending.data())->length & ~COMPRESS_STORED;
+    }
+
+    template <class Sink>
+    void decode(Sink sink) {
+        CompressFrame f;
+        memcpy(&f, pending.data(), sizeof(f));
+        const char* payload = pending.data() + sizeof(CompressFrame);
+        int len = (int)(f.length & ~COMPRESS_STORED);
+        if (f.length & COMPRESS_STORED) {
+            if (len != (int)f.rawLength) {
+                failed = true;
+                return;
+            }
+            sink(payload, len);
+        } else {
+            if (!lz_decompress(payload, len, out.data(), (int)f.rawLength)) {
+                failed = true;
+                return;
+            }
+            sink(out.data(), (int)f.rawLength);
+        }
+        rawBytes += f.rawLength;
+        pending.clear();
+    }
+};
+
+#endif // COMPRESS_H
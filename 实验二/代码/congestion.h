@@ -0,0 +1,347 @@
+#ifndef CONGESTION_H
+#define CONGESTION_H
+
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <algorithm>
+
+// 可插拔的拥塞控制
+// 发送端负责记分板和丢包恢复 (哪些包要重传),拥塞控制算法只负责窗口和发送速率:
+// 每个 ACK 调用 on_ack,记分板判定丢包 (进入快速恢复) 时调用 on_loss,恢复结束时调用 on_recovery_exit,
+// 重传超时调用 on_timeout. 窗口单位为包,速率单位为包/秒.
+
+// 一个 ACK 带来的信息
+struct AckSample {
+    int newlyAcked;             // 这个 ACK 新确认的包数 (含 SACK)
+    bool advanced;              // 是否推进了窗口左边界
+    bool inRecovery;            // 发送端当前是否处于快速恢复
+    long long rttUs;            // 这个 ACK 得到的 RTT 样本 (微秒),没有样本时为 -1
+    long long srttUs;           // 平滑 RTT (微秒),还没有样本时为 0
+    long long inflight;         // 已发送未确认的包数
+    long long delivered;        // 从连接开始累计确认的包数
+    long long nowUs;            // 当前时间 (微秒)
+};
+
+class CongestionControl {
+public:
+    virtual ~CongestionControl() {}
+    virtual const char* name() const = 0;
+    virtual void on_ack(const AckSample& s) = 0;
+    virtual void on_loss() = 0;
+    virtual void on_recovery_exit() = 0;
+    virtual void on_timeout() = 0;
+    virtual double window() const = 0;              // 拥塞窗口 (包)
+    virtual double slow_start_threshold() const = 0;
+    virtual const char* state_name() const = 0;
+    virtual double pacing_rate() const { return 0; } // 建议的发送速率 (包/秒),0 表示由窗口决定
+};
+
+// RENO:慢启动 + 拥塞避免 + 快速恢复
+class RenoCC : public CongestionControl {
+public:
+    enum RenoState {
+        SLOW_START,                     // 慢启动
+        CONGESTION_AVOIDANCE,           // 拥塞避免
+        FAST_RECOVERY                   // 快速恢复
+    };
+
+    double cwnd = 1.0;                  // 拥塞窗口，代表“发送方觉得网络能承受多少包”
+    int ssthresh = 16;                  // 慢启动阈值
+    RenoState state = SLOW_START;
+
+    const char* name() const override { return "reno"; }
+
+    void on_ack(const AckSample& s) override {
+        if (state == FAST_RECOVERY) {
+            // 快速恢复期间，每有一个包离开网络，cwnd 加 1 (允许发送新数据)
+            if (!s.advanced) cwnd += s.newlyAcked;
+            return;
+        }
+        if (state == SLOW_START) {
+            cwnd += s.newlyAcked;               // 每确认一个包，窗口加 1
+            if (cwnd >= ssthresh) {
+                state = CONGESTION_AVOIDANCE;
+            }
+        } else {
+            cwnd += s.newlyAcked / cwnd;        // 每确认一个包，窗口加 1/cwnd
+        }
+    }
+
+    void on_loss() override {
+        ssthresh = std::max(2, (int)cwnd / 2);  // 阈值减半
+        cwnd = ssthresh + 3;                    // 快速恢复阶段，拥塞窗口设置为阈值加3
+        state = FAST_RECOVERY;
+    }
+
+    void on_recovery_exit() override {
+        cwnd = (double)ssthresh;                // 退出快速恢复 (Deflation),将 cwnd 恢复为 ssthresh
+        state = CONGESTION_AVOIDANCE;
+    }
+
+    void on_timeout() override {
+        ssthresh = std::max(2, (int)cwnd / 2);
+        cwnd = 1.0;                             // 重置为1
+        state = SLOW_START;                     // 重新进入慢启动阶段
+    }
+
+    double window() const override { return cwnd; }
+    double slow_start_threshold() const override { return ssthresh; }
+    const char* state_name() const override {
+        return state == SLOW_START ? "slow_start" : state == CONGESTION_AVOIDANCE ? "congestion_avoidance" : "fast_recovery";
+    }
+};
+
+// CUBIC (RFC 8312):拥塞避免阶段窗口按距上次丢包的时间的三次函数增长,与 RTT 无关,
+// 在高带宽、长 RTT 的链路上能很快回到丢包前的窗口
+class CubicCC : public CongestionControl {
+public:
+    static constexpr double C = 0.4;
+    static constexpr double BETA = 0.7;         // 丢包后窗口乘以 BETA
+
+    double cwnd = 1.0;
+    double ssthresh = 16;
+    double wMax = 0;                            // 上次丢包时的窗口
+    double wLastMax = 0;                        // 再上一次丢包时的窗口 (快速收敛用)
+    double k = 0;                               // 窗口增长回 wMax 所需的时间 (秒)
+    long long epochStartUs = -1;                // 本轮拥塞避免开始的时间,-1 表示还没开始
+    double wEst = 0;                            // 按 Reno 速度估算的窗口 (TCP 友好区域)
+    bool recovering = false;
+
+    const char* name() const override { return "cubic"; }
+
+    void on_ack(const AckSample& s) override {
+        if (recovering) return;                 // 快速恢复期间窗口保持不变
+        if (cwnd < ssthresh) {
+            cwnd += s.newlyAcked;               // 慢启动
+            return;
+        }
+        if (epochStartUs < 0) {
+            epochStartUs = s.nowUs;
+            if (cwnd < wMax) {
+                k = std::cbrt((wMax - cwnd) / C);
+            } else {
+                k = 0;
+                wMax = cwnd;
+            }
+            wEst = cwnd;
+        }
+        double rtt = (s.srttUs > 0 ? s.srttUs : 100000) / 1e6;
+        double t = (s.nowUs - epochStartUs) / 1e6 + rtt;                // 预测一个 RTT 之后的目标窗口
+        double target = C * (t - k) * (t - k) * (t - k) + wMax;
+
+        // TCP 友好区域:不比同样条件下的 Reno 慢
+        wEst += 3 * (1 - BETA) / (1 + BETA) * s.newlyAcked / cwnd;
+        if (wEst > target) target = wEst;
+
+        if (target > cwnd) {
+            cwnd += (target - cwnd) / cwnd * s.newlyAcked;
+        } else {
+            cwnd += 0.01 * s.newlyAcked / cwnd; // 已经超过目标时只缓慢增长
+        }
+    }
+
+    void reduce() {
+        epochStartUs = -1;
+        // 快速收敛:窗口比上次丢包时还小,说明有新的流加入,让出更多带宽
+        if (cwnd < wLastMax) {
+            wLastMax = cwnd;
+            wMax = cwnd * (1 + BETA) / 2;
+        } else {
+            wLastMax = cwnd;
+            wMax = cwnd;
+        }
+        ssthresh = std::max(2.0, cwnd * BETA);
+    }
+
+    void on_loss() override {
+        reduce();
+        cwnd = ssthresh;
+        recovering = true;
+    }
+
+    void on_recovery_exit() override {
+        recovering = false;
+    }
+
+    void on_timeout() override {
+        reduce();
+        cwnd = 1.0;
+        recovering = false;
+    }
+
+    double window() const override { return cwnd; }
+    double slow_start_threshold() const override { return ssthresh; }
+    const char* state_name() const override {
+        return recovering ? "fast_recovery" : cwnd < ssthresh ? "slow_start" : "congestion_avoidance";
+    }
+};
+
+// BBR 风格的基于模型的拥塞控制:
+// 估计瓶颈带宽 (最近 10 个 RTT 内投递速率的最大值) 和最小 RTT (最近 10 秒内 RTT 的最小值),
+// 按 带宽 x 最小RTT (BDP) 设置窗口,按带宽乘以增益设置发送速率,丢包本身不减小窗口.
+class BbrCC : public CongestionControl {
+public:
+    enum Mode { STARTUP, DRAIN, PROBE_BW, PROBE_RTT };
+
+    static constexpr double HIGH_GAIN = 2.885;          // 2/ln2,启动阶段每个 RTT 速率翻倍
+    static constexpr double PROBE_GAINS[8] = {1.25, 0.75, 1, 1, 1, 1, 1, 1};
+    static const long long MIN_RTT_WINDOW_US = 10000000;    // 最小 RTT 的有效期 10 秒
+    static const long long PROBE_RTT_US = 200000;           // PROBE_RTT 持续 200ms
+    static const int BW_WINDOW_ROUNDS = 10;                 // 带宽取最近 10 轮的最大值
+    static constexpr double MIN_CWND = 4;
+
+    Mode mode = STARTUP;
+    double pacingGain = HIGH_GAIN;
+    double cwndGain = HIGH_GAIN;
+    double cwnd = 4;
+
+    // 瓶颈带宽估计:按轮 (round,约一个 RTT) 记录投递速率,取窗口内的最大值
+    std::deque<std::pair<long long, double>> bwSamples;    // (轮次, 速率 包/秒)
+    double btlBw = 0;
+    long long round = 0;
+    long long roundStartDelivered = 0;
+    long long rateStartUs = -1;                 // 当前速率采样区间的起点
+    long long rateStartDelivered = 0;
+
+    // 最小 RTT 估计
+    long long minRttUs = -1;
+    long long minRttStampUs = 0;
+    long long probeRttDoneUs = 0;
+
+    // 启动阶段:连续 3 轮带宽增长不到 25% 说明管道已满
+    double fullBw = 0;
+    int fullBwRounds = 0;
+
+    int cycleIndex = 0;
+    long long cycleStartUs = 0;
+
+    const char* name() const override { return "bbr"; }
+
+    double bdp() const {
+        if (btlBw <= 0 || minRttUs <= 0) return 0;
+        return btlBw * minRttUs / 1e6;
+    }
+
+    void update_model(const AckSample& s) {
+        // 最小 RTT
+        if (s.rttUs > 0 && (minRttUs < 0 || s.rttUs <= minRttUs || s.nowUs - minRttStampUs > MIN_RTT_WINDOW_US)) {
+            minRttUs = s.rttUs;
+            minRttStampUs = s.nowUs;
+        }
+
+        // 每确认完一个窗口的数据算一轮
+        if (s.delivered - roundStartDelivered >= std::max(1LL, s.inflight + s.newlyAcked)) {
+            round++;
+            roundStartDelivered = s.delivered;
+        }
+
+        // 投递速率:每隔至少一个最小 RTT 计算一次 Δ已确认包数 / Δ时间
+        if (rateStartUs < 0) {
+            rateStartUs = s.nowUs;
+            rateStartDelivered = s.delivered;
+            return;
+        }
+        long long interval = s.nowUs - rateStartUs;
+        if (minRttUs > 0 && interval >= minRttUs && interval > 0) {
+            double rate = (s.delivered - rateStartDelivered) * 1e6 / interval;
+            rateStartUs = s.nowUs;
+            rateStartDelivered = s.delivered;
+            while (!bwSamples.empty() && bwSamples.back().second <= rate) bwSamples.pop_back();   // 单调队列求窗口最大值
+            bwSamples.push_back(std::make_pair(round, rate));
+        }
+        while (!bwSamples.empty() && bwSamples.front().first < round - BW_WINDOW_ROUNDS) bwSamples.pop_front();
+        btlBw = bwSamples.empty() ? btlBw : bwSamples.front().second;
+    }
+
+    void update_mode(const AckSample& s) {
+        if (mode == STARTUP) {
+            if (btlBw > fullBw * 1.25) {
+                fullBw = btlBw;
+                fullBwRounds = 0;
+                fullBwRoundStart = round;
+            } else if (round > fullBwRoundStart) {
+                fullBwRoundStart = round;
+                if (++fullBwRounds >= 3) {
+                    mode = DRAIN;
+                    pacingGain = 1 / HIGH_GAIN;
+                    cwndGain = HIGH_GAIN;
+                }
+            }
+        }
+        if (mode == DRAIN && s.inflight <= bdp()) {
+            enter_probe_bw(s.nowUs);
+        }
+        if (mode == PROBE_BW && minRttUs > 0 && s.nowUs - cycleStartUs > minRttUs) {
+            cycleIndex = (cycleIndex + 1) % 8;
+            cycleStartUs = s.nowUs;
+            pacingGain = PROBE_GAINS[cycleIndex];
+        }
+        // 最小 RTT 太久没有刷新:把在途数据降到很少,测一次真实的最小 RTT
+        if (mode != PROBE_RTT && minRttUs > 0 && s.nowUs - minRttStampUs > MIN_RTT_WINDOW_US) {
+            mode = PROBE_RTT;
+            pacingGain = 1;
+            probeRttDoneUs = s.nowUs + PROBE_RTT_US;
+        }
+        if (mode == PROBE_RTT && s.nowUs >= probeRttDoneUs) {
+            minRttStampUs = s.nowUs;
+            enter_probe_bw(s.nowUs);
+        }
+    }
+
+    void enter_probe_bw(long long nowUs) {
+        mode = PROBE_BW;
+        cwndGain = 2;
+        cycleIndex = 1;             // 从降速阶段开始,先排空启动时多出的排队
+        pacingGain = PROBE_GAINS[cycleIndex];
+        cycleStartUs = nowUs;
+    }
+
+    void on_ack(const AckSample& s) override {
+        update_model(s);
+        update_mode(s);
+        double target = bdp() * cwndGain;
+        if (mode == PROBE_RTT) {
+            cwnd = MIN_CWND;
+        } else if (target <= 0 || (mode == STARTUP && cwnd < target)) {
+            cwnd += s.newlyAcked;                   // 还没有模型或启动阶段:像慢启动一样增长
+            if (target > 0) cwnd = std::min(cwnd, target);
+        } else {
+            cwnd = std::min(target, cwnd + s.newlyAcked);
+        }
+        cwnd = std::max(cwnd, MIN_CWND);
+    }
+
+    void on_loss() override {}                      // 丢包不是拥塞信号,窗口由模型决定
+    void on_recovery_exit() override {}
+
+    void on_timeout() override {
+        cwnd = MIN_CWND;                            // 超时说明模型可能已经失效,下一个 ACK 按模型重新放大
+    }
+
+    double window() const override { return cwnd; }
+    double slow_start_threshold() const override { return 0; }
+    const char* state_name() const override {
+        return mode == STARTUP ? "startup" : mode == DRAIN ? "drain" : mode == PROBE_BW ? "probe_bw" : "probe_rtt";
+    }
+    double pacing_rate() const override {
+        return btlBw > 0 ? btlBw * pacingGain : 0;
+    }
+
+private:
+    long long fullBwRoundStart = 0;
+};
+
+constexpr double BbrCC::PROBE_GAINS[8];
+constexpr double BbrCC::MIN_CWND;
+
+// 按名字创建拥塞控制算法,未知的名字返回 nullptr
+inline CongestionControl* create_congestion_control(const std::string& name) {
+    if (name == "reno") return new RenoCC();
+    if (name == "cubic") return new CubicCC();
+    if (name == "bbr") return new BbrCC();
+    return nullptr;
+}
+
+#endif // CONGESTION_H
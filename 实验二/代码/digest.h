@@ -0,0 +1,171 @@
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <cstdio>
+
+// 端到端摘要:CRC32C (Castagnoli 多项式)
+// 每个包的 16 位反码和只能发现传输中的部分错误,也不覆盖写文件的过程.
+// 发送端在切分数据时、接收端在按序写入时顺带计算整个数据流的 CRC32C,挥手时交换 (见 DigestOptions),
+// 两端不一致就说明数据损坏,不需要传输结束后再读一遍文件.
+// CPU 支持 SSE4.2 时用 crc32 指令,每条指令处理 8 字节;否则用查表的标量版本.
+//
+// 这里的 "原始" CRC 指不做初值和结果取反的寄存器值,它对数据和初值都是线性的:
+//   raw(s, D) = raw(s, 0...0) ^ raw(0, D)
+// 所以乱序到达的包可以先各自算出 raw(0, 包数据),按序时再用 Crc32cShift 把前面的结果 "移过" 这个包的长度后异或进来.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DIGEST_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+const uint32_t CRC32C_POLY = 0x82F63B78;   // 反射形式的 Castagnoli 多项式
+
+inline const uint32_t* crc32c_table() {
+    static uint32_t table[256];
+    static bool ready = false;
+    if (!ready) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c >> 1) ^ (CRC32C_POLY & (0 - (c & 1)));
+            }
+            table[i] = c;
+        }
+        ready = true;
+    }
+    return table;
+}
+
+// 标量版本 (不支持 SSE4.2 时的回退版本)
+inline uint32_t crc32c_raw_scalar(uint32_t crc, const void* buf, size_t size) {
+    static const uint32_t* table = crc32c_table();
+    const uint8_t* p = (const uint8_t*)buf;
+    while (size--) {
+        crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef DIGEST_HAVE_X86
+// SSE4.2 版本:crc32 指令直接实现 CRC32C
+__attribute__((target("sse4.2")))
+inline uint32_t crc32c_raw_sse42(uint32_t crc, const void* buf, size_t size) {
+    const uint8_t* p = (const uint8_t*)buf;
+#ifdef __x86_64__
+    uint64_t c = crc;
+    while (size >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+        p += 8;
+        size -= 8;
+    }
+    crc = (uint32_t)c;
+#endif
+    while (size >= 4) {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        crc = _mm_crc32_u32(crc, v);
+        p += 4;
+        size -= 4;
+    }
+    while (size--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+#endif // DIGEST_HAVE_X86
+
+typedef uint32_t (*Crc32cFn)(uint32_t crc, const void* buf, size_t size);
+
+// 运行时检测 CPU 是否支持 SSE4.2 (只在第一次调用时检测)
+inline Crc32cFn select_crc32c(const char** name = nullptr) {
+    static Crc32cFn fn = nullptr;
+    static const char* fnName = "scalar";
+    if (!fn) {
+        fn = crc32c_raw_scalar;
+#ifdef DIGEST_HAVE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse4.2")) {
+            fn = crc32c_raw_sse42;
+            fnName = "sse4.2";
+        }
+#endif
+    }
+    if (name) *name = fnName;
+    return fn;
+}
+
+inline uint32_t crc32c_raw(uint32_t crc, const void* buf, size_t size) {
+    static const Crc32cFn fn = select_crc32c();
+    return fn(crc, buf, size);
+}
+
+// 把原始 CRC 移过 n 个 0 字节:raw(crc, 0...0),对 crc 是线性的.
+// 常用的长度 (分段大小) 预先算出 4 张 256 项的表,每次只需 4 次查表;其他长度直接对 0 字节计算
+struct Crc32cShift {
+    size_t length = 0;
+    uint32_t table[4][256];
+
+    void init(size_t n) {
+        length = n;
+        std::vector<char> zeros(n, 0);
+        uint32_t basis[32];
+        for (int i = 0; i < 32; i++) {
+            basis[i] = crc32c_raw(1u << i, zeros.data(), n);
+        }
+        for (int k = 0; k < 4; k++) {
+            for (int b = 0; b < 256; b++) {
+                uint32_t v = 0;
+                for (int i = 0; i < 8; i++) {
+                    if (b >> i & 1) v ^= basis[k * 8 + i];
+                }
+                table[k][b] = v;
+            }
+        }
+    }
+
+    uint32_t apply(uint32_t crc, size_t n) const {
+        if (n == length) {
+            return table[0][crc & 0xFF] ^ table[1][(crc >> 8) & 0xFF] ^ table[2][(crc >> 16) & 0xFF] ^ table[3][crc >> 24];
+        }
+        static const char zeros[4096] = {0};
+        while (n > 0) {
+            size_t k = n < sizeof(zeros) ? n : sizeof(zeros);
+            crc = crc32c_raw(crc, zeros, k);
+            n -= k;
+        }
+        return crc;
+    }
+};
+
+// 一个数据流的 CRC32C,按序追加数据
+struct Crc32c {
+    uint32_t state = 0xFFFFFFFF;
+    uint64_t bytes = 0;
+
+    void update(const void* data, size_t len) {
+        state = crc32c_raw(state, data, len);
+        bytes += len;
+    }
+
+    // 追加一段已经单独算出 raw(0, 数据) 的数据
+    void append(uint32_t raw, size_t len, const Crc32cShift& shift) {
+        state = shift.apply(state, len) ^ raw;
+        bytes += len;
+    }
+
+    uint32_t value() const { return state ^ 0xFFFFFFFF; }
+};
+
+inline std::string digest_str(uint32_t crc) {
+    char buf[9];
+    snprintf(buf, sizeof(buf), "%08x", crc);
+    return buf;
+}
+
+#endif // DIGEST_H
@@ -0,0 +1,110 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include "rdt.h"
+#include <windows.h>
+
+// 发送端的事件循环
+// 不再用固定 10ms 的 select 轮询,而是同时等待两个内核对象:
+//   套接字事件 (WSAEventSelect 关联 FD_READ):ACK 一到达就被唤醒;
+//   可等待定时器:设为下一个重传或节拍截止时间,到点就被唤醒.
+// Windows 上对应 Linux 的 epoll + timerfd. 系统支持时使用高精度定时器 (Windows 10 1803 起),否则精度约 1ms.
+// 也可以用 init_notify() 改为等待其他线程的通知 (由 ACK 线程读套接字,发送线程只等通知和定时器).
+struct EventLoop {
+    enum Result { READABLE, TIMER, TIMEOUT };
+
+    WSAEVENT sockEvent = WSA_INVALID_EVENT;
+    HANDLE notifyEvent = NULL;      // init_notify() 模式下等待的事件
+    HANDLE timer = NULL;
+    bool highResolution = false;    // 是否拿到了高精度定时器
+
+    long long wakeups = 0;          // 统计:被套接字唤醒的次数
+    long long timerFires = 0;       // 统计:被定时器唤醒的次数
+
+    bool init(SOCKET s) {
+        sockEvent = WSACreateEvent();
+        if (sockEvent == WSA_INVALID_EVENT || WSAEventSelect(s, sockEvent, FD_READ) != 0) {
+            return false;
+        }
+        timer = create_timer();
+        return timer != NULL;
+    }
+
+    // 再把一个套接字关联到同一个事件上:任一套接字可读都会唤醒,由调用方逐个取数据
+    bool add_socket(SOCKET s) {
+        return WSAEventSelect(s, sockEvent, FD_READ) == 0;
+    }
+
+    // 不关联套接字,等待其他线程调用 notify()
+    bool init_notify() {
+        notifyEvent = CreateEvent(NULL, FALSE, FALSE, NULL);    // 自动复位
+        if (notifyEvent == NULL) {
+            return false;
+        }
+        timer = create_timer();
+        return timer != NULL;
+    }
+
+    // 其他线程调用:唤醒等待中的线程 (套接字模式下也可以用来让等待提前返回)
+    void notify() {
+        if (notifyEvent) {
+            SetEvent(notifyEvent);
+        } else {
+            WSASetEvent(sockEvent);
+        }
+    }
+
+    // 优先创建高精度定时器;旧系统或旧版头文件中没有 CreateWaitableTimerExW,所以动态查找
+    HANDLE create_timer() {
+        typedef HANDLE (WINAPI *CreateTimerExFn)(void*, const wchar_t*, DWORD, DWORD);
+        const DWORD HIGH_RESOLUTION = 0x00000002;       // CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+        const DWORD ALL_ACCESS = 0x1F0003;              // TIMER_ALL_ACCESS
+        CreateTimerExFn createEx = (CreateTimerExFn)GetProcAddress(GetModuleHandleA("kernel32.dll"), "CreateWaitableTimerExW");
+        if (createEx) {
+            HANDLE t = createEx(NULL, NULL, HIGH_RESOLUTION, ALL_ACCESS);
+            if (t) {
+                highResolution = true;
+                return t;
+            }
+        }
+        return CreateWaitableTimer(NULL, FALSE, NULL);  // 自动复位的普通定时器
+    }
+
+    // 等待套接字可读 (或收到通知) 或 waitUs 微秒后定时器到期 (小于 0 表示只等套接字),最多等 maxMs 毫秒
+    // 返回 READABLE 时调用方应先 reset_socket() 再把套接字中的数据取空,避免漏掉复位之前到达的数据
+    Result wait(long long waitUs, DWORD maxMs) {
+        HANDLE handles[2] = {notifyEvent ? notifyEvent : (HANDLE)sockEvent, timer};
+        DWORD count = 1;
+        if (waitUs >= 0) {
+            LARGE_INTEGER due;
+            due.QuadPart = -(waitUs * 10);              // 负数表示相对时间,单位 100ns
+            SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE);
+            count = 2;
+        }
+        DWORD ret = WaitForMultipleObjects(count, handles, FALSE, maxMs);
+        if (ret == WAIT_OBJECT_0) {
+            wakeups++;
+            return READABLE;
+        }
+        if (ret == WAIT_OBJECT_0 + 1) {
+            timerFires++;
+            return TIMER;
+        }
+        return TIMEOUT;
+    }
+
+    void reset_socket() {
+        WSAResetEvent(sockEvent);
+    }
+
+    void close() {
+        if (timer) CloseHandle(timer);
+        if (notifyEvent) CloseHandle(notifyEvent);
+        if (sockEvent != WSA_INVALID_EVENT) WSACloseEvent(sockEvent);
+        timer = NULL;
+        notifyEvent = NULL;
+        sockEvent = WSA_INVALID_EVENT;
+    }
+};
+
+#endif // EVENT_LOOP_H
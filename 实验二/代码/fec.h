@@ -0,0 +1,166 @@
+#ifndef FEC_H
+#define FEC_H
+
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// 前向纠错 (FEC):异或校验包
+// 发送端把连续发出的 K 个新数据包分成一组,组内最后一个包发出后紧跟一个校验包,数据是组内各包数据 (不足分段大小的补 0) 的异或.
+// 一组中只丢一个包时,接收端用校验包和另外 K-1 个包异或就能还原它,不必等一个 RTT 后的重传,拥塞窗口也不会因此减半.
+// 头部中的分组信息:
+//   数据包: ack = 所在分组第一个包的序列号, window = 分组大小 K (0 表示不在任何分组中)
+//   校验包: flags 带 FLAG_FEC, seq = 分组第一个包的序列号, window = 分组实际包数, ack = 组内各包数据长度的异或
+// 接收端按分组累加收到的数据包,不需要保留已经交付的包.
+
+const int FEC_MIN_BLOCK = 4;            // 自适应时的最小分组 (丢包率很高时每 4 个包一个校验包)
+const int FEC_MAX_BLOCK = 32;           // 自适应时的最大分组
+const double FEC_MIN_LOSS = 0.002;      // 丢包率低于此值时不发校验包
+
+// dst ^= src,每次处理 8 字节
+inline void fec_xor(char* dst, const char* src, int len) {
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, dst + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dst + i, &a, 8);
+    }
+    for (; i < len; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+// 按观测到的丢包率选择分组大小,使每组平均丢包数约为 0.25 (一组只能还原一个包);返回 0 表示不需要 FEC
+inline int fec_block_for_loss(double loss) {
+    if (loss < FEC_MIN_LOSS) {
+        return 0;
+    }
+    return std::max(FEC_MIN_BLOCK, std::min(FEC_MAX_BLOCK, (int)(0.25 / loss)));
+}
+
+// 发送端:当前分组的校验数据
+// 批量发送只记录数据指针,flush 之前不能覆盖,所以校验包缓冲区有 slots 个轮流使用 (多于一批的最大包数)
+struct FecEncoder {
+    std::vector<char> buffers;
+    int segSize = 0;
+    int slots = 0;
+    int slot = 0;                       // 当前分组使用的缓冲区
+
+    long long start = 0;                // 当前分组第一个包的索引
+    int size = 0;                       // 当前分组的计划大小,0 表示没有进行中的分组
+    int count = 0;                      // 已加入的包数
+    uint16_t lengthXor = 0;             // 各包数据长度的异或
+    int maxLength = 0;                  // 最长的包,即校验包的数据长度
+
+    void init(int seg, int slotCount) {
+        segSize = seg;
+        slots = slotCount;
+        buffers.assign((size_t)seg * slotCount, 0);
+    }
+
+    char* current() { return &buffers[(size_t)slot * segSize]; }
+
+    void begin(long long index, int k) {
+        start = index;
+        size = k;
+        count = 0;
+        lengthXor = 0;
+        maxLength = 0;
+        memset(current(), 0, segSize);
+    }
+
+    void add(const char* data, int len) {
+        fec_xor(current(), data, len);
+        lengthXor ^= (uint16_t)len;
+        maxLength = std::max(maxLength, len);
+        count++;
+    }
+
+    bool full() const { return size > 0 && count == size; }
+
+    // 结束当前分组,返回校验包数据;下一个分组换用另一个缓冲区
+    const char* finish() {
+        const char* p = current();
+        slot = (slot + 1) % slots;
+        size = 0;
+        return p;
+    }
+};
+
+// 接收端:按分组累加收到的数据包,分组只缺一个包且校验包已到时还原它
+// 序列号都是还原后的 64 位序列号
+struct FecDecoder {
+    struct Block {
+        std::vector<char> data;         // 组内已收到的包 (和校验包) 数据的异或
+        uint16_t lengthXor = 0;
+        int offsetXor = 0;              // 已收到的包在组内位置的异或,只缺一个包时由它得出缺的是哪个
+        int count = 0;                  // 已收到的数据包数
+        int size = 0;                   // 分组大小:校验包给出的实际包数,校验包未到时为数据包中的计划大小
+        bool parity = false;            // 校验包是否已到
+        bool done = false;              // 已经收齐或还原过
+    };
+
+    std::map<long long, Block> blocks;  // 分组第一个包的序列号 -> 分组
+    int segSize = 0;
+    long long parityReceived = 0;       // 收到的校验包数 (含不再需要的)
+    long long recovered = 0;            // 还原出的包数
+
+    Block& get(long long start) {
+        Block& b = blocks[start];
+        if (b.data.empty()) {
+            b.data.assign(segSize, 0);
+        }
+        return b;
+    }
+
+    // 一个新的数据包 (不是重复包)
+    void add_data(long long start, int size, long long seq, const char* data, int len) {
+        Block& b = get(start);
+        if (b.done) return;
+        if (!b.parity) b.size = size;
+        fec_xor(&b.data[0], data, len);
+        b.lengthXor ^= (uint16_t)len;
+        b.offsetXor ^= (int)(seq - start);
+        if (++b.count == b.size) b.done = true;
+    }
+
+    void add_parity(long long start, int size, const char* data, int len, uint16_t lengthXor) {
+        Block& b = get(start);
+        if (b.done || b.parity) return;
+        b.size = size;
+        b.parity = true;
+        fec_xor(&b.data[0], data, len);
+        b.lengthXor ^= lengthXor;
+    }
+
+    // 分组可以还原时返回 true,给出缺失包的序列号、数据和长度 (数据在分组的缓冲区中,下次 prune 之前有效)
+    bool recover(long long start, long long& seq, const char*& data, int& len) {
+        auto it = blocks.find(start);
+        if (it == blocks.end()) return false;
+        Block& b = it->second;
+        if (b.done || !b.parity || b.count != b.size - 1 || b.lengthXor > segSize) return false;
+        int all = 0;
+        for (int i = 0; i < b.size; i++) all ^= i;
+        seq = start + (all ^ b.offsetXor);
+        data = &b.data[0];
+        len = b.lengthXor;
+        b.done = true;
+        recovered++;
+        return true;
+    }
+
+    // 丢掉所有包都已按序交付的分组 (序列号小于 expectedSeq)
+    void prune(long long expectedSeq) {
+        while (!blocks.empty()) {
+            auto it = blocks.begin();
+            if (it->second.size == 0 || it->first + it->second.size > expectedSeq) break;
+            blocks.erase(it);
+        }
+    }
+};
+
+#endif // FEC_H
@@ -0,0 +1,307 @@
+#include "rdt.h"
+#include "udp_batch.h"
+#include "event_loop.h"
+#include <map>
+#include <queue>
+#include <random>
+#include <iomanip>
+
+using namespace std;
+
+// 网络损伤代理
+// 放在发送端和接收端之间的本地 UDP 中继:发送端把包发给代理,代理转发给接收端,接收端的 ACK 原路返回.
+// 两个方向 (fwd: 发送端 -> 接收端, rev: 接收端 -> 发送端) 分别模拟丢包、时延、抖动、乱序、重复和带宽/队列限制.
+// 每个包按计算出的释放时间放入一个按时间排序的队列,到点才发出,所以增加时延不会降低吞吐量
+// (时延期间后面的包照常收发),不像在发送线程中 sleep 那样把整个发送端卡住.
+//
+// 每个客户端 (发送端地址) 使用独立的上游套接字,接收端看到的仍是多个不同的对端,可以配合 receiver --serve 使用.
+// 所有套接字关联到同一个事件上,与释放时间的定时器一起等待 (见 event_loop.h),有高精度定时器时时延的精度在 1ms 以内.
+
+// 一个方向上的损伤参数和统计
+struct Impairment {
+    double loss = 0;                // 丢包率
+    double delayMs = 0;             // 固定时延
+    double jitterMs = 0;            // 时延在 [-jitter, +jitter] 内均匀抖动
+    double reorder = 0;             // 乱序概率:被选中的包额外晚到 reorderMs,后面的包会先到
+    double reorderMs = 2;
+    double dup = 0;                 // 重复概率
+    double rateMbps = 0;            // 链路带宽 (Mbit/s),0 表示不限
+    long long queueBytes = 0;       // 瓶颈队列容量 (字节),队列满时尾部丢弃,0 表示不限
+
+    long long linkFreeUs = 0;       // 链路空闲的时刻 (前面的包发送完毕)
+
+    long long received = 0;         // 统计:收到的包
+    long long lost = 0;             // 统计:随机丢弃的包
+    long long queueDrops = 0;       // 统计:队列满丢弃的包
+    long long duplicated = 0;       // 统计:重复的包
+    long long reordered = 0;        // 统计:乱序的包
+    long long forwarded = 0;        // 统计:转发出去的包
+};
+
+// 等待释放的包
+struct Pending {
+    long long releaseUs;            // 释放时间
+    long long order;                // 释放时间相同时按到达顺序
+    SOCKET sock;                    // 从哪个套接字发出
+    sockaddr_in to;
+    Impairment* dir;
+    vector<char> data;
+
+    bool operator>(const Pending& o) const {
+        return releaseUs != o.releaseUs ? releaseUs > o.releaseUs : order > o.order;
+    }
+};
+
+// 一个客户端的会话:客户端地址和转发给接收端时使用的上游套接字
+struct Session {
+    sockaddr_in client;
+    SOCKET upstream;
+    long long lastActiveUs;
+};
+
+const int MAX_DATAGRAM = 65535;
+const int DRAIN_LIMIT = 256;        // 每次唤醒从一个套接字最多取的包数,避免一个方向的突发耽误另一个方向和包的释放
+const long long SESSION_IDLE_US = 60LL * 1000000;   // 会话空闲这么久就关闭上游套接字
+
+Impairment fwd, rev;
+priority_queue<Pending, vector<Pending>, greater<Pending>> releaseQueue;
+long long arrivalOrder = 0;
+mt19937 rng;
+uniform_real_distribution<double> uniform(0.0, 1.0);
+auto epoch = chrono::steady_clock::now();
+
+inline long long now_us() {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - epoch).count();
+}
+
+inline bool chance(double p) {
+    return p > 0 && uniform(rng) < p;
+}
+
+// 对收到的一个包施加损伤,计算释放时间后放入队列
+void impair(Impairment& d, const char* data, int len, SOCKET out, const sockaddr_in& to) {
+    d.received++;
+    if (chance(d.loss)) {
+        d.lost++;
+        return;
+    }
+
+    int copies = 1;
+    if (chance(d.dup)) {
+        copies = 2;
+        d.duplicated++;
+    }
+    long long now = now_us();
+    for (int c = 0; c < copies; c++) {
+        // 带宽限制:包依次占用链路,排在前面的包还没发完时要排队,队列超过容量就丢弃
+        long long departUs = now;
+        if (d.rateMbps > 0) {
+            long long backlogUs = max(0LL, d.linkFreeUs - now);
+            if (d.queueBytes > 0 && backlogUs * d.rateMbps / 8 > d.queueBytes) {
+                d.queueDrops++;
+                continue;
+            }
+            long long txUs = (long long)(len * 8 / d.rateMbps);     // 发送这个包需要的时间 (微秒)
+            d.linkFreeUs = max(d.linkFreeUs, now) + txUs;
+            departUs = d.linkFreeUs;
+        }
+
+        double delayMs = d.delayMs;
+        if (d.jitterMs > 0) {
+            delayMs += (uniform(rng) * 2 - 1) * d.jitterMs;
+        }
+        if (chance(d.reorder)) {
+            delayMs += d.reorderMs;
+            d.reordered++;
+        }
+
+        Pending p;
+        p.releaseUs = departUs + (long long)(max(0.0, delayMs) * 1000);
+        p.order = arrivalOrder++;
+        p.sock = out;
+        p.to = to;
+        p.dir = &d;
+        p.data.assign(data, data + len);
+        releaseQueue.push(move(p));
+    }
+}
+
+// 发出所有到了释放时间的包
+void release_due() {
+    long long now = now_us();
+    while (!releaseQueue.empty() && releaseQueue.top().releaseUs <= now) {
+        const Pending& p = releaseQueue.top();
+        sendto(p.sock, p.data.data(), (int)p.data.size(), 0, (sockaddr*)&p.to, sizeof(p.to));
+        p.dir->forwarded++;
+        releaseQueue.pop();
+    }
+}
+
+void print_stats(const char* name, const Impairment& d) {
+    cout << "[" << name << "] received " << d.received << ", lost " << d.lost << ", queue drops " << d.queueDrops
+         << ", duplicated " << d.duplicated << ", reordered " << d.reordered << ", forwarded " << d.forwarded << endl;
+}
+
+// 解析损伤选项:不带前缀时同时作用于两个方向,fwd- / rev- 前缀只作用于一个方向
+bool parse_option(const string& opt, const char* value) {
+    string name = opt.substr(2);
+    vector<Impairment*> dirs = {&fwd, &rev};
+    if (name.compare(0, 4, "fwd-") == 0) {
+        dirs = {&fwd};
+        name = name.substr(4);
+    } else if (name.compare(0, 4, "rev-") == 0) {
+        dirs = {&rev};
+        name = name.substr(4);
+    }
+    double v = atof(value);
+    for (Impairment* d : dirs) {
+        if (name == "loss") d->loss = v;
+        else if (name == "delay") d->delayMs = v;
+        else if (name == "jitter") d->jitterMs = v;
+        else if (name == "reorder") d->reorder = v;
+        else if (name == "reorder-gap") d->reorderMs = v;
+        else if (name == "dup") d->dup = v;
+        else if (name == "rate") d->rateMbps = v;
+        else if (name == "queue") d->queueBytes = (long long)(v * 1024);
+        else return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned seed = (unsigned)chrono::high_resolution_clock::now().time_since_epoch().count();
+
+    // 以 "--" 开头的是选项,其余按顺序作为位置参数
+    vector<string> args;
+    for (int i = 1; i < argc; i++) {
+        string opt = argv[i];
+        if (opt == "--seed" && i + 1 < argc) {
+            seed = (unsigned)atoi(argv[++i]);  // 固定随机种子,便于复现
+        } else if (opt.compare(0, 2, "--") == 0 && i + 1 < argc && parse_option(opt, argv[i + 1])) {
+            i++;
+        } else {
+            args.push_back(opt);
+        }
+    }
+
+    if (args.size() < 3) {
+        cout << "Usage: " << argv[0] << " <listen_port> <target_ip> <target_port> [options]" << endl;
+        cout << "  --loss p  --delay ms  --jitter ms  --reorder p  --reorder-gap ms  --dup p  --rate Mbps  --queue KB  --seed n" << endl;
+        cout << "  Options apply to both directions; prefix with fwd- (sender -> receiver) or rev- (receiver -> sender) for one direction." << endl;
+        cout << "Example: " << argv[0] << " 9000 127.0.0.1 8080 --fwd-loss 0.05 --delay 20 --jitter 5 --rate 100 --queue 256" << endl;
+        return 1;
+    }
+    rng.seed(seed);
+
+    int listenPort = atoi(args[0].c_str());
+    sockaddr_in target;
+    target.sin_family = AF_INET;
+    target.sin_port = htons(atoi(args[2].c_str()));
+    target.sin_addr.s_addr = inet_addr(args[1].c_str());
+
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+
+    // 面向发送端的监听套接字
+    SOCKET listenSock = socket(AF_INET, SOCK_DGRAM, 0);
+    set_nonblocking(listenSock);
+    sockaddr_in listenAddr;
+    listenAddr.sin_family = AF_INET;
+    listenAddr.sin_port = htons(listenPort);
+    listenAddr.sin_addr.s_addr = INADDR_ANY;
+    if (bind(listenSock, (sockaddr*)&listenAddr, sizeof(listenAddr)) == SOCKET_ERROR) {
+        cout << "Bind failed." << endl;
+        return 1;
+    }
+    int sockBuf = 8 << 20;
+    setsockopt(listenSock, SOL_SOCKET, SO_RCVBUF, (char*)&sockBuf, sizeof(sockBuf));
+
+    cout << "Proxy listening on port " << listenPort << ", forwarding to " << args[1] << ":" << args[2] << endl;
+    cout << fixed << setprecision(3);
+    cout << "fwd: loss " << fwd.loss << ", delay " << fwd.delayMs << " ms, jitter " << fwd.jitterMs << " ms, reorder " << fwd.reorder
+         << ", dup " << fwd.dup << ", rate " << fwd.rateMbps << " Mbps, queue " << fwd.queueBytes / 1024 << " KB" << endl;
+    cout << "rev: loss " << rev.loss << ", delay " << rev.delayMs << " ms, jitter " << rev.jitterMs << " ms, reorder " << rev.reorder
+         << ", dup " << rev.dup << ", rate " << rev.rateMbps << " Mbps, queue " << rev.queueBytes / 1024 << " KB" << endl;
+    cout.unsetf(ios::fixed);
+
+    EventLoop loop;
+    if (!loop.init(listenSock)) {
+        cout << "Failed to create event loop." << endl;
+        return 1;
+    }
+
+    // 客户端地址 -> 会话
+    map<pair<uint32_t, uint16_t>, Session> sessions;
+    vector<char> buf(MAX_DATAGRAM);
+    long long lastSweepUs = 0;
+    long long lastReported = 0;
+
+    while (true) {
+        release_due();
+
+        // 等待任一套接字可读或下一个包的释放时间
+        long long waitUs = -1;
+        if (!releaseQueue.empty()) {
+            waitUs = max(0LL, releaseQueue.top().releaseUs - now_us());
+        }
+        if (waitUs != 0) {
+            loop.wait(waitUs, 1000);
+        }
+        loop.reset_socket();
+
+        // 发送端 -> 接收端
+        for (int n = 0; n < DRAIN_LIMIT; n++) {
+            sockaddr_in from;
+            int fromLen = sizeof(from);
+            int len = recvfrom(listenSock, buf.data(), MAX_DATAGRAM, 0, (sockaddr*)&from, &fromLen);
+            if (len < 0) break;
+            auto key = make_pair((uint32_t)from.sin_addr.s_addr, (uint16_t)from.sin_port);
+            auto it = sessions.find(key);
+            if (it == sessions.end()) {
+                Session s;
+                s.client = from;
+                s.upstream = socket(AF_INET, SOCK_DGRAM, 0);
+                set_nonblocking(s.upstream);
+                setsockopt(s.upstream, SOL_SOCKET, SO_RCVBUF, (char*)&sockBuf, sizeof(sockBuf));
+                loop.add_socket(s.upstream);
+                it = sessions.insert(make_pair(key, s)).first;
+                cout << "[Session] " << inet_ntoa(from.sin_addr) << ":" << ntohs(from.sin_port) << " opened." << endl;
+            }
+            it->second.lastActiveUs = now_us();
+            impair(fwd, buf.data(), len, it->second.upstream, target);
+        }
+
+        // 接收端 -> 发送端
+        for (auto& kv : sessions) {
+            Session& s = kv.second;
+            for (int n = 0; n < DRAIN_LIMIT; n++) {
+                sockaddr_in from;
+                int fromLen = sizeof(from);
+                int len = recvfrom(s.upstream, buf.data(), MAX_DATAGRAM, 0, (sockaddr*)&from, &fromLen);
+                if (len < 0) break;
+                s.lastActiveUs = now_us();
+                impair(rev, buf.data(), len, listenSock, s.client);
+            }
+        }
+
+        // 每 5 秒关闭空闲的会话 (空闲 60 秒的会话在释放队列中已经没有包),有新流量时输出统计
+        long long now = now_us();
+        if (now - lastSweepUs >= 5000000) {
+            lastSweepUs = now;
+            for (auto it = sessions.begin(); it != sessions.end();) {
+                if (now - it->second.lastActiveUs < SESSION_IDLE_US) {
+                    ++it;
+                    continue;
+                }
+                cout << "[Session] " << inet_ntoa(it->second.client.sin_addr) << ":" << ntohs(it->second.client.sin_port) << " idle, closed." << endl;
+                closesocket(it->second.upstream);
+                it = sessions.erase(it);
+            }
+            if (fwd.received + rev.received != lastReported) {
+                lastReported = fwd.received + rev.received;
+                print_stats("fwd", fwd);
+                print_stats("rev", rev);
+            }
+        }
+    }
+}
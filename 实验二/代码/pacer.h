@@ -0,0 +1,38 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <algorithm>
+
+// 发送节拍器 (pacing)
+// 不让窗口一打开就把所有包背靠背地发出去,而是按速率给每个包排一个最早发送时间,
+// 把一个窗口的数据均匀地分布在一个 RTT 内,避免突发把交换机的浅缓冲区打满造成丢包.
+// 为了减少定时开销,允许积攒最多 burst 个包的额度一起发送. 时间单位为微秒.
+struct Pacer {
+    double rate = 0;                // 发送速率 (包/秒),0 表示不限速
+    long long nextUs = 0;           // 下一个包的最早发送时间
+    int burst = 2;                  // 空闲后最多可以连续发送的包数
+
+    // 每轮由拥塞控制的状态更新速率
+    void set_rate(double packetsPerSec) {
+        rate = packetsPerSec;
+    }
+
+    bool can_send(long long nowUs) const {
+        return rate <= 0 || nowUs >= nextUs;
+    }
+
+    // 发出一个包后推迟下一个包的发送时间;空闲过后额度最多积攒 burst 个包
+    void on_send(long long nowUs) {
+        if (rate <= 0) return;
+        long long gap = (long long)(1e6 / rate);
+        nextUs = std::max(nextUs, nowUs - burst * gap) + gap;
+    }
+
+    // 距离下一个包可以发送还要等多久,不限速时返回 0
+    long long wait_us(long long nowUs) const {
+        if (rate <= 0) return 0;
+        return std::max(0LL, nextUs - nowUs);
+    }
+};
+
+#endif // PACER_H
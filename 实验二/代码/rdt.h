@@ -1,87 +1,172 @@
-#ifndef RDT_H
-#define RDT_H
-
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#include <iostream>
-#include <cstdint>
-#include <vector>
-#include <string>
-#include <chrono>                   // 时间库
-#include <algorithm>
-#include <cstring>                  // memset()
-
-#pragma comment(lib, "ws2_32.lib")  // 告知编译器链接 ws2_32.lib 库(Windows Socket 库)
-
-// 常量定义
-const int MSS = 1024;               // 最大分段大小,每个数据包的数据部分最多 1024 字节
-const int HEADER_SIZE = 20;         // 头部大小 (固定)
-const int MAX_SEQ = 0xFFFFFFFF;     // 最大序列号,标识数据包顺序
-const int TIMEOUT_MS = 1000;         // 超时时间 (毫秒),这里指的是重传超时
-
-// 标志位
-const uint16_t FLAG_SYN = 0x01;     // 同步标志,用于连接建立
-const uint16_t FLAG_ACK = 0x02;     // 确认标志,用于确认收到数据
-const uint16_t FLAG_FIN = 0x04;     // 结束标志,用于断开连接
-
-// 数据包结构
-#pragma pack(push, 1)           // 将结构体的对齐方式设置为1字节对齐,避免编译器为了对齐而在结构体成员之间插入填充字节,确保数据包结构在内存中的布局与网络传输格式一致
-struct PacketHeader {
-    uint32_t seq;       // 序列号
-    uint32_t ack;       // 确认号
-    uint16_t flags;     // 标志位
-    uint16_t checksum;  // 校验和
-    uint16_t length;    // 数据长度
-    uint16_t window;    // 窗口大小 (用于流量控制)
-    uint32_t padding;   // 填充，确保头部总长 20 字节(对齐)
-};
-
-struct Packet {
-    PacketHeader header;
-    char data[MSS];
-};
-#pragma pack(pop)               // 恢复默认对齐方式
-
-// 校验和计算函数
-inline uint16_t calculate_checksum(Packet* pkt) {
-    uint16_t old_checksum = pkt->header.checksum;
-    pkt->header.checksum = 0;
-    
-    uint32_t sum = 0;
-    uint16_t* ptr = (uint16_t*)pkt;
-    int size = sizeof(PacketHeader) + pkt->header.length;       // 只计算头部和有效数据部分
-
-    while (size > 1) {
-        sum += *ptr++;          // 每次加2字节(uint16_t)
-        size -= 2;              // 减少已处理的字节数
-    }
-    if (size > 0) {
-        sum += *(uint8_t*)ptr;  // 处理剩余的1个单字节
-    }
-
-    // sum>>16 是为了处理溢出的高16位，将其加回低16位,这样做可以确保最终的校验和仍然是一个16位的值,并且符合网络协议中对校验和的定义.
-    // 直至没有进位为止
-    while (sum >> 16) {         
-        sum = (sum & 0xFFFF) + (sum >> 16);
-    }
-
-    pkt->header.checksum = old_checksum; // 恢复原来的校验和
-
-    // 取反得到最终的校验和
-    return (uint16_t)(~sum);        
-}
-
-// 打印数据包信息 (调试用)
-inline void print_packet_info(const char* tag, const Packet& pkt) {
-    std::cout << "[" << tag << "] "
-              << "Seq: " << pkt.header.seq << " "
-              << "Ack: " << pkt.header.ack << " "
-              << "Len: " << pkt.header.length << " "
-              << "Flags: ";
-    if (pkt.header.flags & FLAG_SYN) std::cout << "SYN ";
-    if (pkt.header.flags & FLAG_ACK) std::cout << "ACK ";
-    if (pkt.header.flags & FLAG_FIN) std::cout << "FIN ";
-    std::cout << std::endl;
-}
-
-#endif // RDT_H
+#ifndef RDT_H
+#define RDT_H
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <iostream>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <chrono>                   // 时间库
+#include <algorithm>
+#include <cstring>                  // memset()
+#include <cstdio>                   // snprintf()
+#include "checksum.h"               // 反码求和 (SIMD 加速)
+
+#pragma comment(lib, "ws2_32.lib")  // 告知编译器链接 ws2_32.lib 库(Windows Socket 库)
+
+// 常量定义
+const int MSS = 1024;               // 默认分段大小,每个数据包的数据部分最多 1024 字节 (实际大小在握手时协商)
+const int MAX_MSS = 65507 - 20;     // 可协商的最大分段大小:UDP 数据报最大 65507 字节减去头部
+const int HEADER_SIZE = 20;         // 头部大小 (固定)
+const uint32_t MAX_SEQ = 0xFFFFFFFF;    // 最大序列号,之后回绕到 0 (还原为 64 位序列号见 seq_unwrap)
+const int TIMEOUT_MS = 1000;         // 初始重传超时 (毫秒),拿到 RTT 样本后按 RFC 6298 自适应调整
+const int RTO_MIN_MS = 20;          // 重传超时下限 (毫秒),Windows 默认计时器精度约 15.6ms
+const int RTO_MAX_MS = 60000;       // 重传超时上限 (毫秒)
+
+// 标志位
+const uint16_t FLAG_SYN = 0x01;     // 同步标志,用于连接建立
+const uint16_t FLAG_ACK = 0x02;     // 确认标志,用于确认收到数据
+const uint16_t FLAG_FIN = 0x04;     // 结束标志,用于断开连接
+const uint16_t FLAG_SACK = 0x08;    // 选择确认:ack 为累计确认号,数据部分为 SACK 块
+const uint16_t FLAG_WND = 0x10;     // window 字段有效 (接收端通告窗口);不带数据的 ACK|WND 包是发送端的零窗口探测
+const uint16_t FLAG_FEC = 0x20;     // 校验包 (前向纠错,见 fec.h);SYN / SYN+ACK 中表示请求 / 同意使用 FEC
+const uint16_t FLAG_COMPRESS = 0x40;    // 只用于 SYN / SYN+ACK:请求 / 同意压缩数据 (见 compress.h)
+const uint16_t FLAG_SESSION = 0x80;     // 只用于 SYN / SYN+ACK:请求 / 同意多文件会话 (见 session.h)
+const uint16_t FLAG_RESUME = 0x100;     // 断点续传 (见 resume.h):SYN / SYN+ACK 中表示请求 / 同意续传,握手期间的位图请求和回复
+
+// 数据包结构
+#pragma pack(push, 1)           // 将结构体的对齐方式设置为1字节对齐,避免编译器为了对齐而在结构体成员之间插入填充字节,确保数据包结构在内存中的布局与网络传输格式一致
+struct PacketHeader {
+    uint32_t seq;       // 序列号 (64 位序列号的低 32 位,回绕)
+    uint32_t ack;       // 确认号 (启用 FEC 时数据包和校验包在这里放分组信息,见 fec.h)
+    uint16_t flags;     // 标志位
+    uint16_t checksum;  // 校验和
+    uint16_t length;    // 数据长度
+    uint16_t window;    // 接收窗口 (包数,用于流量控制):带 FLAG_WND 时,序列号小于 ack + window 的包接收端都能接收
+    uint32_t connId;    // 连接 ID,由发送端在握手前随机选定,接收端据此区分同一端口上的多个连接 (旧版为填充,值为 0)
+};
+
+// 控制包和默认大小的数据包.
+// 协商出更大的分段时,数据包放在按 HEADER_SIZE + 分段大小 分配的缓冲区中,通过 Packet* 访问
+struct Packet {
+    PacketHeader header;
+    char data[MSS];
+};
+
+// SYN / SYN+ACK 携带的握手选项 (放在数据部分)
+// 发送端在 SYN 中给出希望使用的分段大小,接收端在 SYN+ACK 中回复双方都能接受的分段大小
+struct SynOptions {
+    uint16_t mss;       // 分段大小 (数据部分字节数)
+};
+
+// 条带传输时 SYN 在 SynOptions 之后携带的选项
+// 每个条带是一个独立的连接,序列号都从 1 开始,接收端把 seq 号包写到 offset + (seq-1)*分段大小 处.
+// 不带这个选项的连接 (旧版发送端) 从偏移 0 开始
+struct StripeOptions {
+    uint64_t offset;    // 本条带在文件中的起始偏移
+};
+
+// 请求断点续传时 SYN 在 StripeOptions 之后携带的选项,接收端据此判断断点文件是否属于这次传输
+struct ResumeOptions {
+    uint64_t fileSize;  // 整个文件的大小
+    uint64_t length;    // 本条带的字节数
+};
+
+// 同意续传时 SYN+ACK 在 SynOptions 之后携带位图的大小.
+// 发送端随后逐段请求位图 (FLAG_RESUME,seq 为位图中的字节偏移),接收端回复 FLAG_RESUME | FLAG_ACK,数据为这一段位图
+struct ResumeReply {
+    uint32_t bitmapBytes;
+};
+
+// FIN 和确认 FIN 的 ACK 在数据部分携带的端到端摘要 (见 digest.h),旧版的 FIN / ACK 不带数据.
+// 摘要覆盖本连接按序交付的全部数据 (压缩前 / 解压后),续传时只覆盖这次传输的区间
+struct DigestOptions {
+    uint32_t crc32c;
+    uint64_t bytes;     // 摘要覆盖的字节数
+};
+#pragma pack(pop)               // 恢复默认对齐方式
+
+// SACK 块:接收端已经收到的一段连续序列号 [start, end),位于累计确认号之后
+// 带 FLAG_SACK 的 ACK 中,header.ack 表示序列号小于它的包都已收到,数据部分是若干个 SackBlock
+struct SackBlock {
+    uint32_t start;
+    uint32_t end;
+};
+const int MAX_SACK_BLOCKS = 8;      // 一个 ACK 最多携带的 SACK 块数
+
+// 校验和计算函数
+inline uint16_t calculate_checksum(Packet* pkt) {
+    uint16_t old_checksum = pkt->header.checksum;
+    pkt->header.checksum = 0;
+    
+    int size = sizeof(PacketHeader) + pkt->header.length;       // 只计算头部和有效数据部分
+    uint32_t sum = checksum_sum(pkt, size);                     // 按 CPU 支持情况选择 AVX2/SSE2/标量实现,见 checksum.h
+
+    // sum>>16 是为了处理溢出的高16位，将其加回低16位,这样做可以确保最终的校验和仍然是一个16位的值,并且符合网络协议中对校验和的定义.
+    // 直至没有进位为止
+    while (sum >> 16) {         
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+
+    pkt->header.checksum = old_checksum; // 恢复原来的校验和
+
+    // 取反得到最终的校验和
+    return (uint16_t)(~sum);        
+}
+
+// 校验和计算函数 (头部与数据分开存放的版本,用于分散/聚集发送)
+// 头部长度为偶数 (20 字节),所以分两段求和与连续求和的结果完全相同
+inline uint16_t calculate_checksum(PacketHeader* hdr, const char* data) {
+    uint16_t old_checksum = hdr->checksum;
+    hdr->checksum = 0;
+
+    uint32_t sum = checksum_sum(hdr, sizeof(PacketHeader));
+    sum += checksum_sum(data, hdr->length);
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+
+    hdr->checksum = old_checksum;
+    return (uint16_t)(~sum);
+}
+
+// 32 位序列号的回绕处理 (RFC 1982 序列号算术)
+// 线上的序列号只有 32 位,两端内部使用不回绕的 64 位序列号. 只要线上的值与参照的 64 位序列号相差不到 2^31
+// (窗口远小于此),就能把它无歧义地还原为离参照最近的 64 位序列号,之后所有比较都在 64 位上进行.
+inline long long seq_unwrap(uint32_t wire, long long ref) {
+    return ref + (int32_t)(wire - (uint32_t)ref);
+}
+
+// 连接 ID 的显示形式 (8 位十六进制),也用作接收端输出文件名的后缀
+inline std::string conn_id_str(uint32_t connId) {
+    char buf[9];
+    snprintf(buf, sizeof(buf), "%08x", connId);
+    return buf;
+}
+
+// 打印数据包信息 (调试用)
+inline void print_packet_info(const char* tag, const Packet& pkt) {
+    std::cout << "[" << tag << "] "
+              << "Seq: " << pkt.header.seq << " "
+              << "Ack: " << pkt.header.ack << " "
+              << "Len: " << pkt.header.length << " "
+              << "Flags: ";
+    if (pkt.header.flags & FLAG_SYN) std::cout << "SYN ";
+    if (pkt.header.flags & FLAG_ACK) std::cout << "ACK ";
+    if (pkt.header.flags & FLAG_FIN) std::cout << "FIN ";
+    if (pkt.header.flags & FLAG_WND) std::cout << "WND(" << pkt.header.window << ") ";
+    if (pkt.header.flags & FLAG_FEC) std::cout << "FEC ";
+    if (pkt.header.flags & FLAG_COMPRESS) std::cout << "COMPRESS ";
+    if (pkt.header.flags & FLAG_SESSION) std::cout << "SESSION ";
+    if (pkt.header.flags & FLAG_RESUME) std::cout << "RESUME ";
+    if (pkt.header.flags & FLAG_SACK) {
+        const SackBlock* blocks = (const SackBlock*)pkt.data;
+        for (int i = 0; i < pkt.header.length / (int)sizeof(SackBlock); i++) {
+            std::cout << "SACK[" << blocks[i].start << "," << blocks[i].end << ") ";
+        }
+    }
+    std::cout << std::endl;
+}
+
+#endif // RDT_H
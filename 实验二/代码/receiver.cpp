@@ -1,166 +1,1200 @@
-#include "rdt.h"
-#include <fstream>
-#include <map>
-
-using namespace std;
-
-SOCKET sock;                            // Socket,用于UDP通信
-sockaddr_in clientAddr;                 // 客户端地址(IP + 端口),用于发送 ACK
-int addrLen = sizeof(clientAddr);       // 地址长度,用于 recvfrom 和 sendto 函数
-bool connected = false;                 // 连接状态,确保握手完成后才处理数据包
-int rcvWindowSize = 20;                 // 接收窗口大小 (默认20),可通过命令行参数修改
-
-// 接收缓冲区 (用于乱序重排)
-map<uint32_t, Packet> recvBuffer;       // 序列号 到 数据包Packet 的映射
-uint32_t expectedSeq = 1;               // 期望收到的下一个序列号,数据包从 1 开始,握手包序列号为 0
-ofstream outFile;
-
-// 发送 ACK 确认包
-// 在 SR 选择性重传模式下，每次收到数据包(无论是否期望的)，都要立即发送 ACK，确认该包已被收到
-// ackNum: 要确认的序列号(收到包的序列号), targetAddr: 发送 ACK 的目标地址
-void send_ack(uint32_t ackNum, sockaddr_in& targetAddr) {
-    Packet ackPkt;
-    memset(&ackPkt, 0, sizeof(ackPkt));
-    ackPkt.header.flags = FLAG_ACK;
-    ackPkt.header.ack = ackNum; // ACK 字段设置为收到的包的序列号，配合发送端的 SR 逻辑
-    ackPkt.header.length = 0;
-    ackPkt.header.checksum = calculate_checksum(&ackPkt);
-
-    sendto(sock, (char*)&ackPkt, sizeof(PacketHeader), 0, (sockaddr*)&targetAddr, sizeof(targetAddr));
-    // cout << "[ACK] Sent ACK for " << ackNum << endl;
-}
-
-int main(int argc, char* argv[]) {
-    // 参数检查,必须至少是3个:(程序名 + port + output_file)
-    if (argc < 3) {
-        cout << "Usage: " << argv[0] << " <port> <output_file> [window_size]" << endl;
-        return 1;
-    }
-
-    int port = atoi(argv[1]);               // 将端口号字符串转换为整数
-    string outFileName = argv[2];           // 输出文件名
-    
-    if (argc >= 4) {
-        rcvWindowSize = atoi(argv[3]);
-        cout << "Receive Window Size set to: " << rcvWindowSize << endl;
-    }
-
-    WSADATA wsaData;
-    WSAStartup(MAKEWORD(2, 2), &wsaData);   // 初始化 Winsock,版本 2.2
-
-    sock = socket(AF_INET, SOCK_DGRAM, 0);  // 创建 UDP 套接字,IPv4和UDP数据报模式
-    
-    sockaddr_in serverAddr;                 // 服务器地址
-    serverAddr.sin_family = AF_INET;        // 地址族:IPv4
-    serverAddr.sin_port = htons(port);      // 主机字节序转换为网络字节序(大端)
-    serverAddr.sin_addr.s_addr = INADDR_ANY; // INADDR_ANY表示绑定到所有本地接口的IP地址,这样服务器可以接受发送到任何本地IP地址的数据包.
-
-    if (bind(sock, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-        cout << "Bind failed." << endl;
-        return 1;
-    }
-
-    cout << "Server listening on port " << port << endl;
-    outFile.open(outFileName, ios::binary);                 // 以二进制模式打开输出文件,确保数据按原始字节写入
-    if (!outFile.is_open()) {
-        cout << "Failed to open output file: " << outFileName << endl;
-        return 1;
-    }
-
-    // 主循环:接收和处理数据包
-    while (true) {
-        Packet recvPkt;
-        sockaddr_in fromAddr;               // 发送方地址
-        int fromLen = sizeof(fromAddr);
-        
-        int len = recvfrom(sock, (char*)&recvPkt, sizeof(recvPkt), 0, (sockaddr*)&fromAddr, &fromLen);
-        if (len > 0) {
-            // 校验和检查
-            if (calculate_checksum(&recvPkt) != recvPkt.header.checksum) {
-                cout << "[Checksum Error] Drop packet." << endl;
-                continue;
-            }
-
-            // 握手逻辑
-            // SYN 处理:收到 SYN，发送 SYN+ACK(TCP 三次握手的第二步)
-            if (recvPkt.header.flags & FLAG_SYN) {
-                cout << "[Handshake] SYN received." << endl;
-                
-                Packet synAckPkt;
-                memset(&synAckPkt, 0, sizeof(synAckPkt));
-                synAckPkt.header.flags = FLAG_SYN | FLAG_ACK;
-                synAckPkt.header.seq = 0;
-                synAckPkt.header.ack = recvPkt.header.seq + 1;
-                synAckPkt.header.checksum = calculate_checksum(&synAckPkt);
-                
-                sendto(sock, (char*)&synAckPkt, sizeof(PacketHeader), 0, (sockaddr*)&fromAddr, fromLen);
-                cout << "[Handshake] SYN+ACK sent." << endl;
-                continue;
-            }
-
-            // 握手最后一步 ACK
-            // ACK 处理：收到纯 ACK(非 SYN)，建立连接(第三步)
-            if ((recvPkt.header.flags & FLAG_ACK) && !connected && recvPkt.header.length == 0 && !(recvPkt.header.flags & FLAG_SYN)) {
-                 cout << "[Handshake] Connection Established." << endl;
-                 connected = true;
-                 clientAddr = fromAddr;     // 保存客户端地址，用于发送 ACK
-                 continue;
-            }
-
-            // 挥手逻辑
-            // FIN 处理：收到 FIN,发送 ACK 确认,并关闭连接
-            if (recvPkt.header.flags & FLAG_FIN) {
-                cout << "[Teardown] FIN received." << endl;
-                Packet ackPkt;
-                memset(&ackPkt, 0, sizeof(ackPkt));
-                ackPkt.header.flags = FLAG_ACK;                 // 发送 ACK 确认
-                ackPkt.header.ack = recvPkt.header.seq + 1;
-                ackPkt.header.checksum = calculate_checksum(&ackPkt);
-                sendto(sock, (char*)&ackPkt, sizeof(PacketHeader), 0, (sockaddr*)&fromAddr, fromLen);
-                cout << "[Teardown] ACK sent. Closing." << endl;
-                break;
-            }
-
-            // 数据处理
-            if (connected && recvPkt.header.length > 0) {
-                uint32_t seq = recvPkt.header.seq;
-
-                // 流量控制：如果序列号超出接收窗口，直接丢弃，不发送 ACK
-                if (seq >= expectedSeq + rcvWindowSize) {
-                    // cout << "[Flow Control] Drop packet " << seq << " outside window." << endl;
-                    continue;
-                }
-                
-                // 发送 ACK (SR 模式：收到什么确认什么)
-                send_ack(seq, fromAddr);
-
-                if (seq == expectedSeq) {
-                    // 收到期望的包，写入文件
-                    outFile.write(recvPkt.data, recvPkt.header.length);
-                    expectedSeq++;
-
-                    // 检查缓冲区是否有后续包
-                    // .count() 用于检查 map 中是否存在指定键,返回 1 表示存在,0 表示不存在
-                    while (recvBuffer.count(expectedSeq)) {
-                        Packet& bufferedPkt = recvBuffer[expectedSeq];
-                        outFile.write(bufferedPkt.data, bufferedPkt.header.length);
-                        recvBuffer.erase(expectedSeq);
-                        expectedSeq++;
-                    }
-                } else if (seq > expectedSeq) {
-                    // 乱序包，缓存
-                    if (recvBuffer.find(seq) == recvBuffer.end()) {
-                        recvBuffer[seq] = recvPkt;
-                        // cout << "[Buffer] Buffered packet " << seq << endl;
-                    }
-                }
-                // 如果 seq < expectedSeq，说明是重复包，已经 ACK 过了，上面已经重发了 ACK
-            }
-        }
-    }
-
-    outFile.close();        
-    closesocket(sock);      
-    WSACleanup();
-    return 0;
-}
+#include "rdt.h"
+#include "async_writer.h"
+#include "udp_batch.h"
+#include "spsc_ring.h"
+#include "event_loop.h"
+#include "transport_stats.h"
+#include "fec.h"
+#include "compress.h"
+#include "session.h"
+#include "resume.h"
+#include "digest.h"
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+
+using namespace std;
+
+// 全局配置 (所有连接共用)
+int rcvWindowSize = 20;                 // 接收窗口大小 (默认20),可通过命令行参数修改
+int maxSegSize = MSS;                   // 接收端能接受的最大分段大小,决定接收缓冲区的大小
+bool useGro = false;                    // 是否启用 UDP 接收合并 (URO)
+int streamCount = 1;                    // 条带数:在 port .. port+streamCount-1 上各接收一个条带,写入同一个输出文件
+bool useResume = false;                 // 断点续传 (--resume):保留输出文件,定期在旁边保存断点,发送端请求时只接收缺失的块
+
+// 延迟确认:每收到 ackEvery 个包或距第一个未确认的包超过 ackDelayUs 微秒才发一个 ACK,出现乱序/重复/填补空洞时立即确认
+int ackEvery = 2;                       // 每多少个包确认一次
+int ackDelayUs = 500;                   // 最长延迟 (微秒)
+const long WINDOW_POLL_US = 1000;       // 通告窗口关小后,每隔这么久检查一次写队列是否腾出了空间
+
+mutex logMutex;                         // 多个接收线程同时输出时保证每行完整
+string statsPath;                       // 统计输出文件 (--stats),.json 为类 qlog 格式,否则为 CSV
+
+// 接收缓冲区 (用于乱序重排)
+// 固定 rcvWindowSize 个槽位,序列号 seq 的包放在 seq % rcvWindowSize 号槽位,启动时一次性分配.
+// 槽位里存的是指向包缓冲区的指针:乱序包到达时把接收缓冲区和空槽位的缓冲区交换,包本身不拷贝.
+struct ReorderBuffer {
+    static const int RX_BURST = 64;     // 一次批量接收的最大包数
+
+    vector<char> pool;                  // 预分配的包缓冲区,比槽位多 RX_BURST 个,多出的用作接收缓冲区
+    int bufSize = 0;                    // 每个包缓冲区的字节数 (头部 + 最大分段大小)
+    vector<Packet*> slots;              // 槽位 -> 包缓冲区
+    vector<uint64_t> full;              // 位图,标记哪些槽位中有包
+    Packet* rx[RX_BURST];               // 下一次批量接收使用的缓冲区
+    int count = 0;                      // 槽位中的包数 (当前的重排深度)
+
+    // rxCount: 额外分配的接收缓冲区个数 (守护进程模式下由分发线程统一接收,不需要)
+    void init(int window, int maxSeg, int rxCount = RX_BURST) {
+        bufSize = sizeof(PacketHeader) + maxSeg;
+        pool.assign((size_t)(window + rxCount) * bufSize, 0);
+        slots.resize(window);
+        for (int i = 0; i < window; i++) slots[i] = buffer(i);
+        for (int k = 0; k < RX_BURST; k++) rx[k] = k < rxCount ? buffer(window + k) : nullptr;
+        full.assign((window + 63) / 64, 0);
+    }
+
+    Packet* buffer(int i) { return (Packet*)&pool[(size_t)i * bufSize]; }
+
+    int index(long long seq) const { return seq % slots.size(); }
+    bool has(long long seq) const { int i = index(seq); return (full[i >> 6] >> (i & 63)) & 1; }
+
+    void set_full(int i) {
+        uint64_t bit = 1ULL << (i & 63);
+        if (!(full[i >> 6] & bit)) count++;
+        full[i >> 6] |= bit;
+    }
+
+    // 把刚收到的包 (在 buf 指向的接收缓冲区中) 放入槽位,原槽位的空缓冲区换成新的接收缓冲区
+    void store(long long seq, Packet*& buf) {
+        int i = index(seq);
+        swap(slots[i], buf);
+        set_full(i);
+    }
+
+    // 把包拷贝进槽位 (接收缓冲区不属于本连接时使用,如守护进程模式下分发线程的缓冲区)
+    void copy_in(long long seq, const Packet& pkt) {
+        int i = index(seq);
+        memcpy(slots[i], &pkt, sizeof(PacketHeader) + pkt.header.length);
+        set_full(i);
+    }
+
+    Packet& at(long long seq) { return *slots[index(seq)]; }
+
+    // 只标记该序列号已收到 (直接定位写入模式下包已交给写线程,不需要缓存)
+    void mark(long long seq) {
+        set_full(index(seq));
+    }
+
+    void release(long long seq) {
+        int i = index(seq);
+        uint64_t bit = 1ULL << (i & 63);
+        if (full[i >> 6] & bit) count--;
+        full[i >> 6] &= ~bit;
+    }
+
+    // 扫描 [from, to] 中已收到的序列号,生成最多 maxBlocks 个 SACK 块,返回块数
+    // 整个 64 位字为 0 时一次跳过 64 个序列号;块中是 64 位序列号的低 32 位,加上 isn 后即为线上的序列号
+    int sack_blocks(long long from, long long to, uint32_t isn, SackBlock* out, int maxBlocks) const {
+        int n = 0;
+        bool inBlock = false;
+        for (long long seq = from; seq <= to; seq++) {
+            int i = index(seq);
+            if (!inBlock && (i & 63) == 0 && full[i >> 6] == 0 && i + 64 <= (int)slots.size() && to - seq >= 64) {
+                seq += 63;
+                continue;
+            }
+            if (has(seq)) {
+                if (!inBlock) {
+                    if (n == maxBlocks) break;
+                    out[n].start = (uint32_t)(seq + isn);
+                    inBlock = true;
+                }
+                out[n].end = (uint32_t)(seq + 1 + isn);
+            } else if (inBlock) {
+                inBlock = false;
+                n++;
+            }
+        }
+        if (inBlock) n++;
+        return n;
+    }
+};
+
+// 直接定位写入模式:每个数据包的数据都在文件偏移 stripeOffset + (seq-1)*segSize 处,收到后立即交给写线程写到最终位置
+// 条带传输时各个连接共用同一个写线程,分别写各自条带所在的区域
+bool directMode = false;
+AsyncWriter writer;
+
+// 一个 RDT 连接的接收状态:重排缓冲区、确认状态和输出文件,由一个接收线程 (或守护进程的一个工作线程) 独占
+struct ReceiverConnection {
+    int id = 0;                         // 条带编号,监听端口为 port + id
+    uint32_t connId = 0;                // 连接 ID (发送端选定,ACK 中原样带回)
+    SOCKET sock = INVALID_SOCKET;       // Socket,用于UDP通信 (守护进程模式下所有连接共用一个)
+    sockaddr_in clientAddr;             // 客户端地址(IP + 端口),用于发送 ACK
+    bool connected = false;             // 连接状态,确保握手完成后才处理数据包
+    int segSize = MSS;                  // 握手协商出的分段大小
+    long long stripeOffset = 0;         // 本连接的数据在输出文件中的起始偏移 (握手时由发送端给出)
+
+    int unackedCount = 0;               // 还没有确认的数据包数
+    bool ackNow = false;                // 本批处理完后需要立即确认
+    chrono::steady_clock::time_point ackDeadline;   // 延迟确认的截止时间
+    uint32_t isn = 0;                   // 发送端的初始序列号 (SYN 的序列号),线上的序列号都减去它再还原为 64 位
+    bool synSeen = false;               // 已经处理过 SYN,synConnId 和 isn 有效
+    uint32_t synConnId = 0;             // SYN 中的连接 ID (单连接模式下 connId 为 0,重复的 SYN 靠它和 isn 识别)
+    vector<char> synAck;                // 发出的 SYN+ACK,重复的 SYN 原样重发
+    long long highestSeq = 0;           // 收到过的最大序列号,SACK 块只需扫描到这里
+    int advertisedWindow = -1;          // 最近一次通告的接收窗口 (包数)
+
+    ReorderBuffer recvBuffer;
+    bool fecEnabled = false;            // 发送端在 SYN 中请求了 FEC (本端总是同意)
+    FecDecoder fec;                     // 按分组累加收到的包,还原丢失的包
+    vector<char> fecPacket;             // 还原出的包 (头部 + 数据),交给正常的数据包处理流程
+    bool compressed = false;            // 发送端在 SYN 中请求了压缩 (本端总是同意):数据包按序拼成压缩字节流,解压后写入
+    StreamDecompressor decompressor;
+    bool session = false;               // 多文件会话 (发送端在 SYN 中请求,直接定位写入模式下不支持):按序的数据是文件记录流
+    SessionWriter sessionWriter;        // 在 outputName 目录下重建发送端的目录树
+    string outputName;                  // 输出文件名,会话模式下改为同名目录
+    bool checkpointing = false;         // 正在记录断点 (本端和发送端都指定了 --resume)
+    bool resumed = false;               // 从断点继续:包只对缺失的区间编号
+    ResumeCheckpoint checkpoint;        // 已写入的块
+    ResumeMap resumeMap;
+    long long resumeSkipped = 0;        // 断点中已有而不必接收的字节数
+    long long outPos = 0;               // 按序写入模式下一个字节在文件中的位置
+    chrono::steady_clock::time_point nextCheckpoint;
+    // 端到端摘要:按序写入时顺带计算;直接定位写入时每个包到达时单独算出,按序时再并入 (见 digest.h)
+    Crc32c digest;
+    Crc32cShift digestShift;            // 把摘要移过一个满分段
+    vector<uint32_t> slotCrc;           // 直接定位写入模式下,已写入但还没按序并入摘要的包的 CRC (按重排缓冲区的槽位)
+    vector<uint16_t> slotLen;
+    bool digestFailed = false;          // 与发送端的摘要不一致
+    long long fileEnd = 0;              // 已收到数据在输出文件中的最大结束偏移
+    long long expectedSeq = 1;          // 期望收到的下一个序列号 (64 位,不回绕),数据包从 1 开始,握手包序列号为 0
+    ofstream outFile;                   // 按序写入模式的输出文件
+    bool verbose = true;                // 是否输出握手/挥手过程 (守护进程模式下只输出连接的建立和关闭)
+
+    // 守护进程模式下由工作线程维护
+    chrono::steady_clock::time_point openedAt;      // 收到 SYN 的时间
+    chrono::steady_clock::time_point lastActive;    // 最近一次收到包的时间,用于回收空闲连接
+    long long bytesReceived = 0;        // 按序交付的字节数
+    bool closed = false;                // 已收到 FIN
+    bool ackPending = false;            // 是否在工作线程的延迟确认列表中
+
+    // 统计
+    long long packetsReceived = 0;      // 收到的数据包数 (含重复和窗口外的包)
+    long long checksumDrops = 0;        // 校验和错误丢弃的包数
+    long long duplicates = 0;           // 重复的数据包数
+    long long windowDrops = 0;          // 超出接收窗口被丢弃的包数
+    int reorderHighWater = 0;           // 重排缓冲区中同时缓存的最大包数
+    long long windowUpdates = 0;        // 窗口重新打开时主动发出的窗口更新数
+    long long windowProbes = 0;         // 收到的零窗口探测数
+
+    // 批量收发
+    UdpRecvBatch rxBatch;               // 一次取走所有已到达的数据包
+    UdpSendBatch ackBatch;              // 处理一批数据包产生的 ACK 一起发出
+    SackBlock ackBlocks[UdpSendBatch::MAX_BATCH][MAX_SACK_BLOCKS];  // 批量发送前 ACK 的数据部分要保持有效
+
+    bool open(int port);
+    void attach(SOCKET shared);
+    bool handle_packet(Packet*& buf, int len, const sockaddr_in& fromAddr, bool canSwap);
+    bool accept_data(long long seq, Packet*& buf, bool canSwap);
+    void deliver(const char* data, int len);
+    void write_output(const char* data, int len);
+    long long data_position(long long seq);
+    void seek_output(long long seq);
+    void save_checkpoint();
+    void fec_recover(long long start);
+    StatsCounters counters();
+    int receive_window();
+    int max_window();
+    bool window_closed();
+    void send_ack(sockaddr_in& targetAddr);
+    void maybe_send_ack();
+    long ack_wait_us();
+    void run();
+};
+
+// 创建并绑定本连接的套接字
+bool ReceiverConnection::open(int port) {
+    sock = socket(AF_INET, SOCK_DGRAM, 0);  // 创建 UDP 套接字,IPv4和UDP数据报模式
+    set_nonblocking(sock);                  // 批量接收时需要非阻塞套接字来判断已经取空
+    ackBatch.init(sock);
+
+    sockaddr_in serverAddr;                 // 服务器地址
+    serverAddr.sin_family = AF_INET;        // 地址族:IPv4
+    serverAddr.sin_port = htons(port);      // 主机字节序转换为网络字节序(大端)
+    serverAddr.sin_addr.s_addr = INADDR_ANY; // INADDR_ANY表示绑定到所有本地接口的IP地址,这样服务器可以接受发送到任何本地IP地址的数据包.
+
+    if (bind(sock, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
+        return false;
+    }
+
+    recvBuffer.init(rcvWindowSize, maxSegSize);
+    // 套接字接收缓冲区至少要能放下一个窗口的数据,否则大分段时发送端一轮突发就会被协议栈丢掉
+    int sockBuf = (rcvWindowSize + ReorderBuffer::RX_BURST) * recvBuffer.bufSize;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (char*)&sockBuf, sizeof(sockBuf));
+    if (useGro) {
+        rxBatch.enable_uro(sock);           // 不支持时仍逐个接收,由 main 报告结果
+    }
+    return true;
+}
+
+// 守护进程模式:使用共享的套接字发送 ACK,数据包由分发线程接收后交给本连接
+void ReceiverConnection::attach(SOCKET shared) {
+    sock = shared;
+    ackBatch.init(sock);
+    recvBuffer.init(rcvWindowSize, maxSegSize, 0);
+    verbose = false;
+}
+
+// 接收窗口 (从 expectedSeq 起,发送端还可以发送的包数)
+// 重排缓冲区的槽位决定了窗口右边界最远为 expectedSeq + rcvWindowSize;
+// 直接定位写入时还受写队列限制:已经收到、排在 expectedSeq 之后的包已在写队列中,之后的新包每个要占用 segSize 字节
+int ReceiverConnection::receive_window() {
+    long long window = rcvWindowSize;
+    if (directMode) {
+        long long room = writer.free_bytes() / streamCount / segSize;  // 条带共用一个写线程,平分写队列
+        window = min(window, room + recvBuffer.count);
+    }
+    return (int)min(window, 65535LL);
+}
+
+// 写队列全空时能通告的最大窗口
+int ReceiverConnection::max_window() {
+    long long window = rcvWindowSize;
+    if (directMode) {
+        window = min(window, (long long)(AsyncWriter::CHUNK_COUNT * AsyncWriter::CHUNK_SIZE) / streamCount / segSize);
+    }
+    return (int)max(1LL, min(window, 65535LL));
+}
+
+// 上次通告的窗口不到最大窗口的一半:写线程跟不上,发送端已经 (或即将) 停下等待窗口更新
+bool ReceiverConnection::window_closed() {
+    return connected && !closed && advertisedWindow >= 0 && advertisedWindow * 2 < max_window();
+}
+
+// 发送 ACK 确认包
+// 累计确认号为 expectedSeq (序列号小于它的包都已收到),其后已收到的包用 SACK 块描述,
+// 这样一个 ACK 就能把接收端的完整状态告诉发送端,不再需要每个包一个 ACK.
+// targetAddr: 发送 ACK 的目标地址
+void ReceiverConnection::send_ack(sockaddr_in& targetAddr) {
+    SackBlock* blocks = ackBlocks[ackBatch.count % UdpSendBatch::MAX_BATCH];
+    int n = 0;
+    if (highestSeq > expectedSeq) {
+        n = recvBuffer.sack_blocks(expectedSeq + 1, highestSeq, isn, blocks, MAX_SACK_BLOCKS);
+    }
+
+    PacketHeader ackHdr;
+    memset(&ackHdr, 0, sizeof(ackHdr));
+    ackHdr.flags = FLAG_ACK | FLAG_SACK | FLAG_WND;
+    ackHdr.ack = (uint32_t)(expectedSeq + isn);     // 线上只有低 32 位,发送端以最后发出的包为参照还原
+    ackHdr.window = (uint16_t)receive_window();
+    ackHdr.connId = connId;
+    if (fecEnabled) {
+        ackHdr.seq = (uint32_t)fec.recovered;       // ACK 不用 seq 字段,启用 FEC 时用它告诉发送端还原了多少个包
+    }
+    advertisedWindow = ackHdr.window;
+    ackHdr.length = n * sizeof(SackBlock);
+    ackHdr.checksum = calculate_checksum(&ackHdr, (const char*)blocks);
+
+    ackBatch.add(ackHdr, (const char*)blocks, targetAddr);      // 处理完这一批数据包后统一发出
+    unackedCount = 0;
+    ackNow = false;
+    // cout << "[ACK] Sent ACK " << expectedSeq << " with " << n << " SACK blocks" << endl;
+}
+
+// 处理完一批数据包后,按延迟确认策略决定是否发送 ACK
+void ReceiverConnection::maybe_send_ack() {
+    if (unackedCount == 0) {
+        // 窗口曾经关小,现在写队列腾出了空间:主动发一个窗口更新,不必等发送端的零窗口探测
+        if (window_closed() && receive_window() * 2 >= max_window()) {
+            windowUpdates++;
+            send_ack(clientAddr);
+        }
+        return;
+    }
+    if (ackNow || unackedCount >= ackEvery || chrono::steady_clock::now() >= ackDeadline) {
+        send_ack(clientAddr);
+    }
+}
+
+// 距离延迟确认截止时间还有多少微秒,没有待确认的包时返回 -1 (一直等待)
+long ReceiverConnection::ack_wait_us() {
+    if (unackedCount == 0) {
+        return window_closed() ? WINDOW_POLL_US : -1;      // 窗口关小时定期检查写队列
+    }
+    auto left = chrono::duration_cast<chrono::microseconds>(ackDeadline - chrono::steady_clock::now()).count();
+    return left > 0 ? (long)left : 0;
+}
+
+// 处理一个已收到的数据包,收到 FIN (连接关闭) 时返回 false
+// buf 指向接收缓冲区;canSwap 为 true 时乱序包通过交换缓冲区放入槽位 (buf 随之换成空缓冲区),否则拷贝进槽位
+bool ReceiverConnection::handle_packet(Packet*& buf, int len, const sockaddr_in& fromAddr, bool canSwap) {
+    Packet& recvPkt = *buf;
+    int fromLen = sizeof(fromAddr);
+
+    // 长度检查:头部中的数据长度不能超过实际收到的字节数,否则校验和会读到缓冲区之外
+    if (len < HEADER_SIZE || recvPkt.header.length > len - HEADER_SIZE) {
+        return true;
+    }
+
+    // 校验和检查
+    if (calculate_checksum(&recvPkt) != recvPkt.header.checksum) {
+        checksumDrops++;
+        lock_guard<mutex> lock(logMutex);
+        cout << "[Checksum Error] Drop packet." << endl;
+        return true;
+    }
+
+    // 握手逻辑
+    // SYN 处理:收到 SYN，发送 SYN+ACK(TCP 三次握手的第二步)
+    if (recvPkt.header.flags & FLAG_SYN) {
+        // 同一连接重复或迟到的 SYN (SYN+ACK 丢失后的重传、网络复制或乱序的包):只重发 SYN+ACK.
+        // 不能重新初始化,否则已收数据的摘要和 FEC 状态被清掉,续传时还会重新打开输出文件
+        if (synSeen && recvPkt.header.connId == synConnId && recvPkt.header.seq == isn) {
+            sendto(sock, synAck.data(), (int)synAck.size(), 0, (sockaddr*)&fromAddr, fromLen);
+            return true;
+        }
+        Packet synAckPkt;
+        memset(&synAckPkt, 0, sizeof(synAckPkt));
+        synAckPkt.header.flags = FLAG_SYN | FLAG_ACK;
+        synAckPkt.header.seq = 0;
+        synAckPkt.header.ack = recvPkt.header.seq + 1;
+        synAckPkt.header.connId = connId;
+        isn = recvPkt.header.seq;                       // 旧版发送端的 SYN 序列号为 0
+        fecEnabled = (recvPkt.header.flags & FLAG_FEC) != 0;
+        compressed = (recvPkt.header.flags & FLAG_COMPRESS) != 0;
+
+        // 协商分段大小:取发送端提议值与本端上限中较小的一个,旧版发送端不带选项时使用默认值
+        int requested = MSS;
+        if (recvPkt.header.length >= sizeof(SynOptions)) {
+            requested = ((SynOptions*)recvPkt.data)->mss;
+        }
+        // 条带传输:发送端在 SynOptions 之后给出本条带在文件中的起始偏移 (只在直接定位写入模式下使用)
+        if (recvPkt.header.length >= sizeof(SynOptions) + sizeof(StripeOptions)) {
+            stripeOffset = (long long)((StripeOptions*)(recvPkt.data + sizeof(SynOptions)))->offset;
+        }
+        segSize = max(1, min(requested, maxSegSize));
+        SynOptions* opts = (SynOptions*)synAckPkt.data;
+        opts->mss = segSize;
+        synAckPkt.header.length = sizeof(SynOptions);
+        digest = Crc32c();
+        if (directMode) {
+            digestShift.init(segSize);
+            slotCrc.assign(rcvWindowSize, 0);
+            slotLen.assign(rcvWindowSize, 0);
+        }
+        if (fecEnabled) {
+            synAckPkt.header.flags |= FLAG_FEC;         // 同意使用 FEC
+            fec.segSize = segSize;
+            fecPacket.assign(sizeof(PacketHeader) + segSize, 0);
+        }
+        if (compressed) {
+            synAckPkt.header.flags |= FLAG_COMPRESS;    // 同意压缩
+        }
+        // 会话:输出文件改为同名目录 (重复的 SYN 不再重建);直接定位写入时输出文件由写线程占用,不同意
+        if ((recvPkt.header.flags & FLAG_SESSION) && !directMode && !session) {
+            outFile.close();
+            remove(outputName.c_str());
+            session = sessionWriter.start(outputName);
+            if (!session) {
+                lock_guard<mutex> lock(logMutex);
+                cout << "[Session] Failed to create output directory: " << outputName << endl;
+            }
+        }
+        if (session) {
+            synAckPkt.header.flags |= FLAG_SESSION;     // 同意多文件会话
+        }
+        // 断点续传:发送端给出文件大小和条带长度,与断点文件一致时从断点继续,否则从头记录新的断点
+        size_t resumeAt = sizeof(SynOptions) + sizeof(StripeOptions);
+        checkpointing = false;
+        resumed = false;
+        if (useResume && (recvPkt.header.flags & FLAG_RESUME) && !compressed && !session &&
+            recvPkt.header.length >= resumeAt + sizeof(ResumeOptions)) {
+            ResumeOptions* ro = (ResumeOptions*)(recvPkt.data + resumeAt);
+            string path = outputName + ".resume" + (streamCount > 1 ? "." + to_string(id) : "");
+            resumed = checkpoint.load(path, ro->fileSize, stripeOffset, ro->length) && checkpoint.missing < checkpoint.chunks;
+            checkpointing = true;
+            resumeMap.build(checkpoint.bitmap, (long long)ro->length, segSize);
+            resumeSkipped = (long long)ro->length - resumeMap.bytes;
+            nextCheckpoint = chrono::steady_clock::now() + chrono::milliseconds(RESUME_CHECKPOINT_MS);
+            if (resumed) {
+                synAckPkt.header.flags |= FLAG_RESUME;  // 同意续传,发送端随后取回位图
+                ((ResumeReply*)(synAckPkt.data + synAckPkt.header.length))->bitmapBytes = (uint32_t)checkpoint.bitmap.size();
+                synAckPkt.header.length += sizeof(ResumeReply);
+                fileEnd = max(fileEnd, stripeOffset + (long long)ro->length);   // 已有的数据不会再收到,文件不能截短
+            }
+        }
+        // 按序写入模式下 main 以保留内容的方式打开了输出文件 (--resume),不续传时清空重写
+        if (useResume && !directMode && !session) {
+            outFile.close();
+            outFile.open(outputName, resumed ? ios::binary | ios::in | ios::out : ios::binary | ios::trunc);
+            outPos = 0;
+        }
+        synAckPkt.header.flags |= FLAG_WND;             // 初始接收窗口,发送端从第一个数据包起就按它限制在途数据
+        synAckPkt.header.window = (uint16_t)receive_window();
+        synAckPkt.header.checksum = calculate_checksum(&synAckPkt);
+
+        synSeen = true;
+        synConnId = recvPkt.header.connId;
+        synAck.assign((char*)&synAckPkt, (char*)&synAckPkt + sizeof(PacketHeader) + synAckPkt.header.length);
+        sendto(sock, (char*)&synAckPkt, sizeof(PacketHeader) + synAckPkt.header.length, 0, (sockaddr*)&fromAddr, fromLen);
+        if (verbose) {
+            lock_guard<mutex> lock(logMutex);
+            cout << "[Handshake] SYN received." << endl;
+            cout << "[Handshake] SYN+ACK sent. Segment size: " << segSize;
+            if (streamCount > 1) cout << ", stripe " << id << " at offset " << stripeOffset;
+            cout << endl;
+        }
+        return true;
+    }
+
+    // 断点续传的位图请求 (握手期间):回复位图中从 seq 开始的一段
+    if ((recvPkt.header.flags & FLAG_RESUME) && !(recvPkt.header.flags & FLAG_ACK) && resumed && !connected) {
+        Packet reply;
+        memset(&reply, 0, sizeof(reply));
+        uint32_t pos = min((uint32_t)recvPkt.header.seq, (uint32_t)checkpoint.bitmap.size());
+        reply.header.flags = FLAG_RESUME | FLAG_ACK;
+        reply.header.seq = pos;
+        reply.header.connId = connId;
+        reply.header.length = (uint16_t)min((size_t)MSS, checkpoint.bitmap.size() - pos);
+        memcpy(reply.data, checkpoint.bitmap.data() + pos, reply.header.length);
+        reply.header.checksum = calculate_checksum(&reply);
+        sendto(sock, (char*)&reply, sizeof(PacketHeader) + reply.header.length, 0, (sockaddr*)&fromAddr, fromLen);
+        return true;
+    }
+
+    // 握手最后一步 ACK
+    // ACK 处理：收到纯 ACK(非 SYN)，建立连接(第三步)
+    if ((recvPkt.header.flags & FLAG_ACK) && !connected && recvPkt.header.length == 0 && !(recvPkt.header.flags & FLAG_SYN)) {
+        if (verbose) {
+            lock_guard<mutex> lock(logMutex);
+            cout << "[Handshake] Connection Established." << endl;
+        }
+        connected = true;
+        clientAddr = fromAddr;          // 保存客户端地址，用于发送 ACK
+        return true;
+    }
+
+    // 挥手逻辑
+    // FIN 处理：收到 FIN,发送 ACK 确认,并关闭连接
+    if (recvPkt.header.flags & FLAG_FIN) {
+        Packet ackPkt;
+        memset(&ackPkt, 0, sizeof(ackPkt));
+        ackPkt.header.flags = FLAG_ACK;                 // 发送 ACK 确认
+        ackPkt.header.ack = recvPkt.header.seq + 1;
+        ackPkt.header.connId = connId;
+        DigestOptions* mine = (DigestOptions*)ackPkt.data;     // 本端写入的数据的摘要,发送端据此判断传输是否成功
+        mine->crc32c = digest.value();
+        mine->bytes = digest.bytes;
+        ackPkt.header.length = sizeof(DigestOptions);
+        ackPkt.header.checksum = calculate_checksum(&ackPkt);
+        ackBatch.flush();               // 先发出之前数据包的 ACK
+        sendto(sock, (char*)&ackPkt, sizeof(PacketHeader) + ackPkt.header.length, 0, (sockaddr*)&fromAddr, fromLen);
+        if (verbose) {
+            lock_guard<mutex> lock(logMutex);
+            cout << "[Teardown] FIN received." << endl;
+            cout << "[Teardown] ACK sent. Closing." << endl;
+        }
+        // 旧版发送端的 FIN 不带摘要,无法核对
+        if (recvPkt.header.length >= sizeof(DigestOptions)) {
+            DigestOptions* theirs = (DigestOptions*)recvPkt.data;
+            digestFailed = theirs->crc32c != mine->crc32c || theirs->bytes != mine->bytes;
+            lock_guard<mutex> lock(logMutex);
+            if (digestFailed) {
+                cout << "[Digest] Mismatch on connection " << conn_id_str(connId) << ": sender CRC32C " << digest_str(theirs->crc32c)
+                     << " over " << theirs->bytes << " bytes, written " << digest_str(mine->crc32c) << " over " << mine->bytes
+                     << " bytes. Transfer failed." << endl;
+            } else if (verbose) {
+                cout << "[Digest] CRC32C " << digest_str(mine->crc32c) << " over " << mine->bytes << " bytes matches the sender." << endl;
+            }
+        }
+        if (compressed && !decompressor.complete()) {
+            lock_guard<mutex> lock(logMutex);
+            cout << "[Decompress] Compressed stream of connection " << conn_id_str(connId) << " is corrupt or truncated." << endl;
+        }
+        // 全部收齐时断点文件不再需要,否则 (发送端放弃了) 保存最后的进度
+        if (checkpointing) {
+            if (checkpoint.missing == 0) {
+                checkpoint.remove_file();
+            } else {
+                save_checkpoint();
+            }
+            checkpointing = false;
+        }
+        if (session && !sessionWriter.finished) {
+            lock_guard<mutex> lock(logMutex);
+            cout << "[Session] Session of connection " << conn_id_str(connId) << " is incomplete"
+                 << (sessionWriter.failed ? ": " + sessionWriter.error : "") << "." << endl;
+        }
+        return false;
+    }
+
+    // 零窗口探测:不带数据,立即回复一个带当前窗口的 ACK
+    if (connected && !closed && (recvPkt.header.flags & FLAG_WND) && recvPkt.header.length == 0) {
+        windowProbes++;
+        unackedCount = max(unackedCount, 1);
+        ackNow = true;
+        return true;
+    }
+
+    // 校验包 (FEC):累加进分组;分组中的包都已按序收到时不再需要
+    if (connected && !closed && fecEnabled && (recvPkt.header.flags & FLAG_FEC)) {
+        long long start = seq_unwrap(recvPkt.header.seq - isn, expectedSeq);
+        fec.parityReceived++;
+        if (start + recvPkt.header.window > expectedSeq && recvPkt.header.length <= segSize) {
+            fec.add_parity(start, recvPkt.header.window, recvPkt.data, recvPkt.header.length, (uint16_t)recvPkt.header.ack);
+            fec_recover(start);
+        }
+        return true;
+    }
+
+    // 数据处理
+    if (connected && !closed && recvPkt.header.length > 0) {
+        // 以 expectedSeq 为参照把 32 位序列号还原为 64 位 (与它相差不超过 2^31 个包)
+        long long seq = seq_unwrap(recvPkt.header.seq - isn, expectedSeq);
+        packetsReceived++;
+
+        // 流量控制：如果序列号超出接收窗口，直接丢弃，不发送 ACK
+        if (seq >= expectedSeq + rcvWindowSize) {
+            // cout << "[Flow Control] Drop packet " << seq << " outside window." << endl;
+            windowDrops++;
+            return true;
+        }
+
+        // 记录待确认的包,ACK 在这一批处理完后按延迟确认策略发出
+        long long before = expectedSeq;
+        if (unackedCount++ == 0) {
+            ackDeadline = chrono::steady_clock::now() + chrono::microseconds(ackDelayUs);
+        }
+        highestSeq = max(highestSeq, seq);
+
+        if (!accept_data(seq, buf, canSwap)) {
+            duplicates++;
+        } else if (fecEnabled && recvPkt.header.window > 0 && recvPkt.header.length <= segSize) {
+            // 属于某个 FEC 分组:累加进分组,分组只差一个包且校验包已到时就地还原
+            long long start = seq_unwrap(recvPkt.header.ack - isn, seq);
+            fec.add_data(start, recvPkt.header.window, seq, recvPkt.data, recvPkt.header.length);
+            fec_recover(start);
+        }
+        // 如果 seq < expectedSeq，说明是重复包,同样需要立即确认
+
+        // 乱序、重复或填补了空洞:立即确认,让发送端尽快知道丢了哪些包
+        if (seq != before || expectedSeq - before > 1) {
+            ackNow = true;
+        }
+    }
+    return true;
+}
+
+// 把一个数据包交给输出 (按序写入或直接定位写入),是新包时返回 true,重复包返回 false
+// 调用前已经检查过接收窗口;buf 的含义同 handle_packet
+bool ReceiverConnection::accept_data(long long seq, Packet*& buf, bool canSwap) {
+    Packet& pkt = *buf;
+    if (directMode && !compressed && !session) {
+        // 直接定位写入:只要是新包就立即交给写线程,位图只用于去重和推进 expectedSeq
+        if (seq >= expectedSeq && !recvBuffer.has(seq)) {
+            long long pos = data_position(seq);
+            long long offset = stripeOffset + pos;
+            writer.write(offset, pkt.data, pkt.header.length);
+            if (checkpointing) checkpoint.add(pos, pkt.header.length);
+            fileEnd = max(fileEnd, offset + pkt.header.length);
+            bytesReceived += pkt.header.length;
+            int slot = recvBuffer.index(seq);
+            slotCrc[slot] = crc32c_raw(0, pkt.data, pkt.header.length);
+            slotLen[slot] = pkt.header.length;
+            recvBuffer.mark(seq);
+            while (recvBuffer.has(expectedSeq)) {
+                slot = recvBuffer.index(expectedSeq);
+                digest.append(slotCrc[slot], slotLen[slot], digestShift);
+                recvBuffer.release(expectedSeq);
+                expectedSeq++;
+            }
+            reorderHighWater = max(reorderHighWater, recvBuffer.count);
+        } else {
+            return false;
+        }
+    } else if (seq == expectedSeq) {
+        // 收到期望的包，写入文件
+        seek_output(seq);
+        deliver(pkt.data, pkt.header.length);
+        expectedSeq++;
+
+        // 检查缓冲区是否有后续包
+        while (recvBuffer.has(expectedSeq)) {
+            Packet& bufferedPkt = recvBuffer.at(expectedSeq);
+            seek_output(expectedSeq);
+            deliver(bufferedPkt.data, bufferedPkt.header.length);
+            recvBuffer.release(expectedSeq);
+            expectedSeq++;
+        }
+    } else if (seq > expectedSeq) {
+        // 乱序包，缓存 (窗口检查保证 seq 与 expectedSeq 相差不足 rcvWindowSize,槽位不会冲突)
+        if (!recvBuffer.has(seq)) {
+            if (canSwap) {
+                recvBuffer.store(seq, buf);
+            } else {
+                recvBuffer.copy_in(seq, pkt);
+            }
+            // cout << "[Buffer] Buffered packet " << seq << endl;
+            reorderHighWater = max(reorderHighWater, recvBuffer.count);
+        } else {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// 按序交付一个包的数据:压缩时送入解压器,解压出的数据再写入输出
+void ReceiverConnection::deliver(const char* data, int len) {
+    if (!compressed) {
+        write_output(data, len);
+        return;
+    }
+    decompressor.feed(data, len, [this](const char* out, int n) { write_output(out, n); });
+}
+
+// 写入按序的原始数据:按序写入模式写到输出文件;直接定位写入模式下 (压缩时只能按序解压) 写到条带中的对应位置;
+// 会话模式下交给 sessionWriter 拆分成各个文件
+void ReceiverConnection::write_output(const char* data, int len) {
+    digest.update(data, len);
+    if (session) {
+        sessionWriter.feed(data, len);
+    } else if (directMode) {
+        writer.write(stripeOffset + bytesReceived, data, len);
+        fileEnd = max(fileEnd, stripeOffset + bytesReceived + len);
+    } else {
+        outFile.write(data, len);
+        if (checkpointing) checkpoint.add(outPos, len);
+        outPos += len;
+    }
+    bytesReceived += len;
+}
+
+// 包在条带中的偏移:续传时只对缺失的区间编号
+long long ReceiverConnection::data_position(long long seq) {
+    if (!resumed) {
+        return (seq - 1) * segSize;
+    }
+    long long pos;
+    int len;
+    resumeMap.locate(seq - 1, pos, len);
+    return pos;
+}
+
+// 按序写入模式下续传时,包之间可能隔着已有的块,写入前定位到包的位置
+void ReceiverConnection::seek_output(long long seq) {
+    if (!resumed) return;
+    long long pos = data_position(seq);
+    if (pos != outPos) {
+        outFile.seekp(pos);
+        outPos = pos;
+    }
+}
+
+// 保存断点:先让位图中的块都写到文件中,再写位图
+void ReceiverConnection::save_checkpoint() {
+    if (directMode) {
+        writer.sync();
+    } else {
+        outFile.flush();
+    }
+    if (!checkpoint.save()) {
+        lock_guard<mutex> lock(logMutex);
+        cout << "[Resume] Failed to save checkpoint " << checkpoint.path << endl;
+    }
+    nextCheckpoint = chrono::steady_clock::now() + chrono::milliseconds(RESUME_CHECKPOINT_MS);
+}
+
+// 分组可以还原时,把还原出的包当作刚收到的包处理
+void ReceiverConnection::fec_recover(long long start) {
+    long long seq;
+    const char* data;
+    int len;
+    if (fec.recover(start, seq, data, len) && seq >= expectedSeq && seq < expectedSeq + rcvWindowSize) {
+        Packet* pkt = (Packet*)&fecPacket[0];
+        memset(&pkt->header, 0, sizeof(pkt->header));
+        pkt->header.seq = (uint32_t)(seq + isn);
+        pkt->header.length = (uint16_t)len;
+        memcpy(pkt->data, data, len);
+        highestSeq = max(highestSeq, seq);
+        if (accept_data(seq, pkt, false)) {
+            // cout << "[FEC] Recovered packet " << seq << endl;
+            unackedCount = max(unackedCount, 1);
+            ackNow = true;                          // 空洞已经补上,尽快让发送端知道
+        }
+    }
+    fec.prune(expectedSeq);
+}
+
+StatsCounters ReceiverConnection::counters() {
+    return {
+        {"packets_received", packetsReceived},
+        {"checksum_drops", checksumDrops},
+        {"duplicates", duplicates},
+        {"window_drops", windowDrops},
+        {"reorder_high_water", reorderHighWater},
+        {"bytes_written", bytesReceived},
+        {"acks_sent", ackBatch.packets},
+        {"window_updates", windowUpdates},
+        {"window_probes", windowProbes},
+        {"fec_parity_received", fec.parityReceived},
+        {"fec_recovered", fec.recovered},
+        {"payload_bytes", compressed ? decompressor.inBytes : bytesReceived},
+        {"session_files", sessionWriter.files},
+        {"resume_skipped_bytes", resumeSkipped},
+        {"digest_bytes", (long long)digest.bytes},
+        {"digest_failed", digestFailed},
+    };
+}
+
+// 接收线程:接收和处理本连接的数据包,收到 FIN 后返回
+void ReceiverConnection::run() {
+    bool running = true;
+    sockaddr_in fromAddrs[ReorderBuffer::RX_BURST];
+    int rxLens[ReorderBuffer::RX_BURST];
+    while (running) {
+        // 一次取走所有已到达的包,直接收到接收缓冲区中,乱序时交换进槽位
+        // 有待确认的包时最多等到延迟确认的截止时间
+        // 记录断点时至少每个保存间隔醒来一次
+        long waitUs = ack_wait_us();
+        if (checkpointing && (waitUs < 0 || waitUs > RESUME_CHECKPOINT_MS * 1000L)) {
+            waitUs = RESUME_CHECKPOINT_MS * 1000L;
+        }
+        int burst = rxBatch.recv(sock, recvBuffer.rx, fromAddrs, rxLens, ReorderBuffer::RX_BURST, recvBuffer.bufSize, waitUs);
+        for (int k = 0; k < burst && running; k++) {
+            if (rxLens[k] > 0) {
+                running = handle_packet(recvBuffer.rx[k], rxLens[k], fromAddrs[k], true);
+            }
+        }
+        if (running) {
+            maybe_send_ack();
+            if (checkpointing && chrono::steady_clock::now() >= nextCheckpoint) {
+                save_checkpoint();
+            }
+        }
+        ackBatch.flush();                   // 这一批数据包产生的 ACK 一起发出
+    }
+}
+
+// 守护进程模式 (--serve):一个端口上同时接收任意多个发送端的上传,不会在第一个 FIN 后退出
+// 分发线程从共享套接字批量收包,按 (地址, 端口, 连接 ID) 的哈希把包交给固定的工作线程,
+// 同一个连接的包总是由同一个工作线程处理,连接状态不需要加锁.
+// 每个工作线程有自己的连接表,每个连接写各自的输出文件 <output_file>.<连接 ID>.
+bool daemonMode = false;
+string outputPrefix;                    // 输出文件名前缀
+int workerCount = 0;                    // 工作线程数,0 表示按 CPU 核数
+int idleTimeoutMs = 30000;              // 连接超过这么久没有收到包就回收 (发送端已经消失)
+const int CLOSED_LINGER_MS = 2000;      // 收到 FIN 后连接状态再保留这么久,迟到的包不会被当作新连接
+const int SWEEP_INTERVAL_MS = 1000;     // 工作线程检查空闲连接的间隔
+const int WORKER_BUFFERS = 512;         // 每个工作线程在途的包缓冲区数,用完时分发线程丢包 (相当于套接字缓冲区满)
+
+// 连接表的键:对端地址 + 连接 ID (同一地址上的多个连接靠连接 ID 区分)
+struct ConnKey {
+    uint32_t ip;
+    uint16_t port;
+    uint32_t connId;
+
+    bool operator==(const ConnKey& o) const { return ip == o.ip && port == o.port && connId == o.connId; }
+};
+
+struct ConnKeyHash {
+    size_t operator()(const ConnKey& k) const {
+        uint64_t h = ((uint64_t)k.ip << 16 | k.port) * 0x9E3779B97F4A7C15ULL ^ (uint64_t)k.connId * 0xC2B2AE3D27D4EB4FULL;
+        return (size_t)(h ^ (h >> 29));
+    }
+};
+
+// 分发线程交给工作线程的一个包
+struct RxItem {
+    Packet* pkt;
+    int len;
+    sockaddr_in from;
+};
+
+struct Worker {
+    int id = 0;
+    SOCKET sock = INVALID_SOCKET;       // 共享的套接字,用于发送 ACK
+    SpscRing<RxItem, 1024> inbox;       // 分发线程 -> 工作线程:待处理的包
+    SpscRing<Packet*, 1024> freeBufs;   // 工作线程 -> 分发线程:处理完的包缓冲区
+    EventLoop loop;                     // 等待分发线程的通知或延迟确认的截止时间
+    unordered_map<ConnKey, unique_ptr<ReceiverConnection>, ConnKeyHash> conns;     // 本线程负责的连接
+    vector<ReceiverConnection*> pendingAck;         // 有延迟确认的连接
+    chrono::steady_clock::time_point lastSweep;
+    thread th;
+
+    void handle(RxItem& item);
+    void flush_acks();
+    void sweep();
+    void run();
+};
+
+// 处理分发线程交来的一个包:查找连接,SYN 时新建连接
+void Worker::handle(RxItem& item) {
+    Packet& pkt = *item.pkt;
+    ConnKey key = {item.from.sin_addr.s_addr, item.from.sin_port, pkt.header.connId};
+    auto it = conns.find(key);
+    if (it == conns.end() || (it->second->closed && (pkt.header.flags & FLAG_SYN))) {
+        if (!(pkt.header.flags & FLAG_SYN)) {
+            return;                     // 未知连接 (或已被回收) 的包
+        }
+        if (it != conns.end()) {
+            // 已关闭的连接上又来了 SYN:发送端重用了连接 ID,丢掉旧状态
+            if (it->second->ackPending) {
+                pendingAck.erase(find(pendingAck.begin(), pendingAck.end(), it->second.get()));
+            }
+            conns.erase(it);
+        }
+        unique_ptr<ReceiverConnection> conn(new ReceiverConnection());
+        conn->connId = key.connId;
+        conn->attach(sock);
+        string name = outputPrefix + "." + conn_id_str(key.connId);
+        conn->outputName = name;
+        conn->outFile.open(name, ios::binary);
+        if (!conn->outFile.is_open()) {
+            lock_guard<mutex> lock(logMutex);
+            cout << "[Conn " << conn_id_str(key.connId) << "] Failed to open output file: " << name << endl;
+            return;
+        }
+        conn->openedAt = chrono::steady_clock::now();
+        {
+            lock_guard<mutex> lock(logMutex);
+            cout << "[Conn " << conn_id_str(key.connId) << "] Opened from " << inet_ntoa(item.from.sin_addr) << ":"
+                 << ntohs(item.from.sin_port) << " -> " << name << " (worker " << id << ", " << conns.size() + 1 << " connections)" << endl;
+        }
+        it = conns.insert(make_pair(key, move(conn))).first;
+    }
+
+    ReceiverConnection* conn = it->second.get();
+    conn->lastActive = chrono::steady_clock::now();
+    bool wasClosed = conn->closed;
+    if (!conn->handle_packet(item.pkt, item.len, item.from, false) && !wasClosed) {
+        conn->closed = true;
+        conn->outFile.close();
+        double sec = chrono::duration_cast<chrono::microseconds>(conn->lastActive - conn->openedAt).count() / 1000000.0;
+        lock_guard<mutex> lock(logMutex);
+        cout << "[Conn " << conn_id_str(conn->connId) << "] Closed: " << conn->bytesReceived << " bytes in " << sec << " s ("
+             << (sec > 0 ? conn->bytesReceived / 1024.0 / 1024.0 / sec : 0.0) << " MB/s)";
+        if (conn->session) cout << ", " << conn->sessionWriter.files << " files";
+        cout << endl;
+    } else if (conn->unackedCount > 0 && !conn->ackPending) {
+        conn->ackPending = true;
+        pendingAck.push_back(conn);
+    }
+}
+
+// 按延迟确认策略给有待确认包的连接发 ACK,已经确认完的连接移出列表
+void Worker::flush_acks() {
+    for (size_t i = 0; i < pendingAck.size();) {
+        ReceiverConnection* conn = pendingAck[i];
+        conn->maybe_send_ack();
+        conn->ackBatch.flush();
+        if (conn->unackedCount == 0) {
+            conn->ackPending = false;
+            pendingAck[i] = pendingAck.back();
+            pendingAck.pop_back();
+        } else {
+            i++;
+        }
+    }
+}
+
+// 回收空闲的连接:已关闭的保留 CLOSED_LINGER_MS,未关闭的超过 idleTimeoutMs 没有收到包就认为发送端已经消失
+void Worker::sweep() {
+    auto now = chrono::steady_clock::now();
+    if (now - lastSweep < chrono::milliseconds(SWEEP_INTERVAL_MS)) return;
+    lastSweep = now;
+    for (auto it = conns.begin(); it != conns.end();) {
+        ReceiverConnection* conn = it->second.get();
+        long long idleMs = chrono::duration_cast<chrono::milliseconds>(now - conn->lastActive).count();
+        if (conn->ackPending || idleMs < (conn->closed ? CLOSED_LINGER_MS : idleTimeoutMs)) {
+            ++it;
+            continue;
+        }
+        if (!conn->closed) {
+            lock_guard<mutex> lock(logMutex);
+            cout << "[Conn " << conn_id_str(conn->connId) << "] Idle for " << idleMs / 1000 << " s, reclaimed after "
+                 << conn->bytesReceived << " bytes." << endl;
+        }
+        it = conns.erase(it);           // 析构时关闭输出文件
+    }
+}
+
+// 工作线程:处理分发线程交来的包,发送延迟确认,定期回收空闲连接
+void Worker::run() {
+    lastSweep = chrono::steady_clock::now();
+    while (true) {
+        long waitUs = -1;
+        for (ReceiverConnection* conn : pendingAck) {
+            long w = conn->ack_wait_us();
+            if (waitUs < 0 || w < waitUs) waitUs = w;
+        }
+        if (waitUs != 0) {
+            loop.wait(waitUs, SWEEP_INTERVAL_MS);
+        }
+
+        RxItem item;
+        while (inbox.pop(item)) {
+            handle(item);
+            while (!freeBufs.push(item.pkt)) {
+                this_thread::yield();   // 不会发生:缓冲区总数不超过队列容量
+            }
+        }
+        flush_acks();
+        sweep();
+    }
+}
+
+// 分发线程 (主线程):批量收包,按连接的哈希交给工作线程,用工作线程归还的空缓冲区替换交出去的缓冲区
+// 包本身不拷贝;每个工作线程取走一个缓冲区就归还一个,所以各自的缓冲区数量保持不变
+void serve(SOCKET sock) {
+    int bufSize = sizeof(PacketHeader) + maxSegSize;
+    int n = workerCount > 0 ? workerCount : max(1, (int)thread::hardware_concurrency());
+    vector<char> pool((size_t)(n * WORKER_BUFFERS + ReorderBuffer::RX_BURST) * bufSize);
+    auto buffer = [&](int i) { return (Packet*)&pool[(size_t)i * bufSize]; };
+
+    vector<unique_ptr<Worker>> workers;
+    for (int w = 0; w < n; w++) {
+        workers.push_back(unique_ptr<Worker>(new Worker()));
+        Worker& worker = *workers[w];
+        worker.id = w;
+        worker.sock = sock;
+        if (!worker.loop.init_notify()) {
+            cout << "Failed to create event loop." << endl;
+            return;
+        }
+        for (int i = 0; i < WORKER_BUFFERS; i++) {
+            worker.freeBufs.push(buffer(w * WORKER_BUFFERS + i));
+        }
+    }
+    for (auto& w : workers) {
+        w->th = thread(&Worker::run, w.get());
+    }
+    cout << "Serving with " << n << " worker threads, idle timeout " << idleTimeoutMs / 1000 << " s." << endl;
+
+    UdpRecvBatch rxBatch;
+    if (useGro) {
+        rxBatch.enable_uro(sock);
+    }
+    Packet* rx[ReorderBuffer::RX_BURST];
+    for (int k = 0; k < ReorderBuffer::RX_BURST; k++) rx[k] = buffer(n * WORKER_BUFFERS + k);
+    sockaddr_in fromAddrs[ReorderBuffer::RX_BURST];
+    int rxLens[ReorderBuffer::RX_BURST];
+    vector<char> touched(n);
+    long long dropped = 0;              // 工作线程处理不过来而丢掉的包
+    while (true) {
+        int burst = rxBatch.recv(sock, rx, fromAddrs, rxLens, ReorderBuffer::RX_BURST, bufSize, -1);
+        for (int k = 0; k < burst; k++) {
+            if (rxLens[k] < HEADER_SIZE) continue;
+            ConnKey key = {fromAddrs[k].sin_addr.s_addr, fromAddrs[k].sin_port, rx[k]->header.connId};
+            int w = (int)(ConnKeyHash()(key) % n);
+            Packet* fresh;
+            if (!workers[w]->freeBufs.pop(fresh)) {
+                if (++dropped % 10000 == 1) {
+                    lock_guard<mutex> lock(logMutex);
+                    cout << "[Serve] Worker " << w << " overloaded, " << dropped << " packets dropped." << endl;
+                }
+                continue;
+            }
+            RxItem item = {rx[k], rxLens[k], fromAddrs[k]};
+            workers[w]->inbox.push(item);
+            rx[k] = fresh;
+            touched[w] = 1;
+        }
+        for (int w = 0; w < n; w++) {
+            if (touched[w]) {
+                workers[w]->loop.notify();
+                touched[w] = 0;
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // 以 "--" 开头的是选项,其余按顺序作为位置参数
+    vector<string> args;
+    for (int i = 1; i < argc; i++) {
+        string opt = argv[i];
+        if (opt == "--direct") {
+            directMode = true;              // 乱序包直接写到文件中的最终位置,由独立的写线程完成
+        } else if (opt == "--mss" && i + 1 < argc) {
+            maxSegSize = max(1, min(MAX_MSS, atoi(argv[++i])));     // 发送端提议更大的分段时以此为上限
+        } else if (opt == "--ack-every" && i + 1 < argc) {
+            ackEvery = max(1, atoi(argv[++i]));    // 每多少个包确认一次,1 表示每个包都确认
+        } else if (opt == "--stats" && i + 1 < argc) {
+            statsPath = argv[++i];                  // 结束时写出各连接的计数器
+        } else if (opt == "--ack-delay" && i + 1 < argc) {
+            ackDelayUs = max(0, atoi(argv[++i]));  // 延迟确认的最长等待时间 (微秒)
+        } else if (opt == "--gro") {
+            useGro = true;                  // 一次接收取走协议栈合并的多个数据报
+        } else if (opt == "--streams" && i + 1 < argc) {
+            streamCount = max(1, atoi(argv[++i]));  // 条带数,与发送端的 --streams 一致
+        } else if (opt == "--resume") {
+            useResume = true;               // 中断后重新发送同一个文件时只接收缺失的部分
+        } else if (opt == "--serve") {
+            daemonMode = true;              // 常驻运行,同时接收多个发送端的上传
+        } else if (opt == "--workers" && i + 1 < argc) {
+            workerCount = max(0, atoi(argv[++i]));  // 守护进程的工作线程数
+        } else if (opt == "--idle-timeout" && i + 1 < argc) {
+            idleTimeoutMs = max(1, atoi(argv[++i])) * 1000;   // 空闲连接的回收时间 (秒)
+        } else {
+            args.push_back(opt);
+        }
+    }
+
+    // 参数检查,必须至少是2个位置参数:(port + output_file)
+    if (args.size() < 2) {
+        cout << "Usage: " << argv[0] << " <port> <output_file> [window_size] [--direct] [--mss bytes] [--gro] [--ack-every n] [--ack-delay us] [--streams n] [--resume] [--stats file]" << endl;
+        cout << "       (a sender in session mode turns <output_file> into a directory holding the received tree)" << endl;
+        cout << "       " << argv[0] << " <port> <output_prefix> [window_size] --serve [--workers n] [--idle-timeout s]   (writes <output_prefix>.<connection id>)" << endl;
+        return 1;
+    }
+
+    int port = atoi(args[0].c_str());       // 将端口号字符串转换为整数
+    string outFileName = args[1];           // 输出文件名
+    
+    if (args.size() >= 3) {
+        rcvWindowSize = atoi(args[2].c_str());
+        cout << "Receive Window Size set to: " << rcvWindowSize << endl;
+    }
+    if (streamCount > 1) {
+        directMode = true;                  // 各条带乱序到达,只能按偏移直接写入
+    }
+
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);   // 初始化 Winsock,版本 2.2
+
+    // 守护进程模式:所有连接共用一个端口,每个连接按序写入自己的输出文件
+    if (daemonMode) {
+        if (streamCount > 1 || directMode || useResume) {
+            cout << "--serve writes each connection in order to its own file, --streams, --direct and --resume are not supported." << endl;
+            return 1;
+        }
+        outputPrefix = outFileName;
+        SOCKET sock = socket(AF_INET, SOCK_DGRAM, 0);
+        set_nonblocking(sock);
+        sockaddr_in serverAddr;
+        serverAddr.sin_family = AF_INET;
+        serverAddr.sin_port = htons(port);
+        serverAddr.sin_addr.s_addr = INADDR_ANY;
+        if (bind(sock, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
+            cout << "Bind failed." << endl;
+            return 1;
+        }
+        // 所有连接的包都经过这一个套接字,接收缓冲区尽量开大
+        int sockBuf = 64 << 20;
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (char*)&sockBuf, sizeof(sockBuf));
+        cout << "Server listening on port " << port << " (serve mode)" << endl;
+        serve(sock);
+        closesocket(sock);
+        WSACleanup();
+        return 1;                           // 只有初始化失败时才会返回
+    }
+
+    // 每个条带一个连接,各自监听一个端口
+    vector<unique_ptr<ReceiverConnection>> conns;
+    for (int i = 0; i < streamCount; i++) {
+        conns.push_back(unique_ptr<ReceiverConnection>(new ReceiverConnection()));
+        conns[i]->id = i;
+        if (!conns[i]->open(port + i)) {
+            cout << "Bind failed." << endl;
+            return 1;
+        }
+    }
+
+    if (streamCount > 1) {
+        cout << "Server listening on ports " << port << "-" << port + streamCount - 1 << " (" << streamCount << " stripes)" << endl;
+    } else {
+        cout << "Server listening on port " << port << endl;
+    }
+    for (auto& c : conns) {
+        c->outputName = outFileName;
+    }
+    bool opened;
+    if (directMode) {
+        opened = writer.open(outFileName, useResume);       // 写线程负责预分配和按偏移写入;续传时保留已有内容
+    } else {
+        // 以二进制模式打开输出文件,确保数据按原始字节写入;--resume 时先不清空,握手时决定是否续传
+        conns[0]->outFile.open(outFileName, useResume ? ios::binary | ios::app : ios::binary);
+        opened = conns[0]->outFile.is_open();
+    }
+    if (!opened) {
+        cout << "Failed to open output file: " << outFileName << endl;
+        return 1;
+    }
+
+    if (useGro) {
+        if (conns[0]->rxBatch.recvMsg) {
+            cout << "UDP receive coalescing enabled." << endl;
+        } else {
+            cout << "UDP receive coalescing not supported, receiving datagrams one by one." << endl;
+        }
+    }
+
+    // 只有一个条带时直接在主线程中接收,否则每个条带一个接收线程
+    if (streamCount == 1) {
+        conns[0]->run();
+    } else {
+        vector<thread> workers;
+        for (auto& c : conns) {
+            workers.push_back(thread(&ReceiverConnection::run, c.get()));
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+
+    long long fileEnd = 0;                  // 各条带的最大结束偏移,即最终文件大小
+    long long rxPackets = 0, rxSyscalls = 0, ackPackets = 0, ackSyscalls = 0;
+    for (auto& c : conns) {
+        fileEnd = max(fileEnd, c->fileEnd);
+        rxPackets += c->rxBatch.packets;
+        rxSyscalls += c->rxBatch.syscalls;
+        ackPackets += c->ackBatch.packets;
+        ackSyscalls += c->ackBatch.syscalls;
+        closesocket(c->sock);
+    }
+
+    if (directMode) {
+        writer.close(fileEnd);              // 等待写线程写完,并截掉预分配多出的部分
+        cout << "[Writer] " << writer.bytesWritten << " bytes in " << writer.writeCalls << " writes." << endl;
+    } else {
+        conns[0]->outFile.close();
+    }
+    cout << "[Batch] Recv: " << rxPackets << " packets in " << rxSyscalls << " syscalls, ACK: "
+         << ackPackets << " packets in " << ackSyscalls << " syscalls." << endl;
+    bool failed = false;                    // 有连接的摘要与发送端不一致
+    for (auto& c : conns) {
+        if (streamCount > 1) cout << "[Stats] Stripe " << c->id << ": ";
+        else cout << "[Stats] ";
+        cout << c->packetsReceived << " data packets, " << c->duplicates << " duplicates, " << c->windowDrops
+             << " out-of-window drops, " << c->checksumDrops << " checksum drops, reorder high-water "
+             << c->reorderHighWater << " packets, " << c->bytesReceived << " bytes written";
+        if (c->compressed) {
+            cout << " (decompressed from " << c->decompressor.inBytes << " bytes)";
+        }
+        if (c->resumed) {
+            cout << ", resumed with " << c->resumeSkipped << " bytes already present";
+        }
+        if (c->session) {
+            cout << ", session: " << c->sessionWriter.files << " files, " << c->sessionWriter.bytes << " bytes into "
+                 << outFileName << "/";
+        }
+        if (c->fecEnabled) {
+            cout << ", " << c->fec.parityReceived << " parity packets, " << c->fec.recovered << " recovered by FEC";
+        }
+        cout << ", CRC32C " << digest_str(c->digest.value()) << (c->digestFailed ? " (MISMATCH)" : "") << "." << endl;
+        failed = failed || c->digestFailed;
+        if (!statsPath.empty()) {
+            string path = stats_path(statsPath, c->id, streamCount);
+            if (!write_stats(path, "rdt receiver", "server", c->counters(), vector<StatsSample>())) {
+                cout << "Failed to write stats to " << path << endl;
+            }
+        }
+    }
+    WSACleanup();
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,164 @@
+#ifndef RESUME_H
+#define RESUME_H
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+// 断点续传 (握手时协商,见 FLAG_RESUME)
+// 接收端把输出文件按 RESUME_CHUNK 分块,定期把已经写到文件中的块记成位图保存在输出文件旁边 (断点文件).
+// 传输中断后重新发送同一个文件时,接收端在握手中把位图交给发送端,双方都只对缺失的块编号:
+// 第 1 个包是第一个缺失区间的开头,一个区间发完接着发下一个区间,已经有的数据不再重传.
+// 块大小与条带对齐 (STRIPE_ALIGN) 相同,每个条带有自己的断点文件,块不会跨条带.
+
+const int RESUME_CHUNK = 64 * 1024;         // 位图中一位代表的字节数
+const uint32_t RESUME_MAGIC = 0x52445352;   // "RSDR"
+const int RESUME_CHECKPOINT_MS = 1000;      // 接收端保存断点文件的间隔 (毫秒)
+
+// 缺失区间到包的映射:双方由同一个位图和分段大小得出同样的编号
+struct ResumeMap {
+    struct Range {
+        long long offset;           // 区间在条带中的起始偏移
+        long long length;
+        long long firstPacket;      // 区间第一个包的索引
+    };
+    std::vector<Range> ranges;
+    long long packets = 0;          // 总包数
+    long long bytes = 0;            // 需要传输的字节数
+    int segSize = 0;
+
+    // 位图中为 0 的块组成的区间,length 为条带的字节数 (最后一块可能不满)
+    void build(const std::vector<uint8_t>& bitmap, long long length, int seg) {
+        segSize = seg;
+        ranges.clear();
+        packets = 0;
+        bytes = 0;
+        long long chunks = (length + RESUME_CHUNK - 1) / RESUME_CHUNK;
+        for (long long c = 0; c < chunks; c++) {
+            bool have = c / 8 < (long long)bitmap.size() && (bitmap[c / 8] >> (c % 8) & 1);
+            if (have) continue;
+            long long start = c * RESUME_CHUNK;
+            long long len = std::min((long long)RESUME_CHUNK, length - start);
+            if (!ranges.empty() && ranges.back().offset + ranges.back().length == start) {
+                ranges.back().length += len;
+            } else {
+                ranges.push_back({start, len, 0});
+            }
+        }
+        for (Range& r : ranges) {
+            r.firstPacket = packets;
+            packets += (r.length + seg - 1) / seg;
+            bytes += r.length;
+        }
+    }
+
+    // 索引为 index 的包在条带中的偏移和长度
+    void locate(long long index, long long& pos, int& len) const {
+        auto it = std::upper_bound(ranges.begin(), ranges.end(), index,
+                                   [](long long i, const Range& r) { return i < r.firstPacket; });
+        const Range& r = *(it - 1);
+        long long inRange = (index - r.firstPacket) * segSize;
+        pos = r.offset + inRange;
+        len = (int)std::min((long long)segSize, r.length - inRange);
+    }
+};
+
+#pragma pack(push, 1)
+struct ResumeFileHeader {
+    uint32_t magic;
+    uint32_t chunkSize;
+    uint64_t fileSize;              // 整个文件的大小
+    uint64_t offset;                // 条带在文件中的起始偏移
+    uint64_t length;                // 条带的字节数
+};
+#pragma pack(pop)
+
+// 接收端:记录每块已写入的字节数,块写满时置位;save() 把位图写到断点文件
+// 保存前调用方要保证位图中的数据都已经交给了操作系统 (按序写入时 flush,直接定位写入时等写线程写完),
+// 所以接收端进程中途退出也不会把没写到文件中的块记成已有
+struct ResumeCheckpoint {
+    std::string path;
+    ResumeFileHeader info;
+    std::vector<uint8_t> bitmap;
+    std::vector<uint32_t> filled;   // 每块已写入的字节数
+    long long chunks = 0;
+    long long missing = 0;          // 还没写满的块数
+
+    // 开始记录一个新的传输,原有的断点文件作废
+    void reset(const std::string& file, uint64_t fileSize, uint64_t offset, uint64_t length) {
+        path = file;
+        info.magic = RESUME_MAGIC;
+        info.chunkSize = RESUME_CHUNK;
+        info.fileSize = fileSize;
+        info.offset = offset;
+        info.length = length;
+        chunks = ((long long)length + RESUME_CHUNK - 1) / RESUME_CHUNK;
+        missing = chunks;
+        bitmap.assign((size_t)(chunks + 7) / 8, 0);
+        filled.assign((size_t)chunks, 0);
+    }
+
+    // 读取断点文件,属于同一个文件的同一个条带时返回 true;否则相当于 reset
+    bool load(const std::string& file, uint64_t fileSize, uint64_t offset, uint64_t length) {
+        reset(file, fileSize, offset, length);
+        std::ifstream in(file, std::ios::binary);
+        ResumeFileHeader h;
+        if (!in.read((char*)&h, sizeof(h)) || h.magic != RESUME_MAGIC || h.chunkSize != RESUME_CHUNK ||
+            h.fileSize != fileSize || h.offset != offset || h.length != length) {
+            return false;
+        }
+        if (!in.read((char*)bitmap.data(), bitmap.size())) {
+            std::fill(bitmap.begin(), bitmap.end(), 0);
+            return false;
+        }
+        for (long long c = 0; c < chunks; c++) {
+            if (bitmap[c / 8] >> (c % 8) & 1) {
+                filled[c] = (uint32_t)chunk_length(c);
+                missing--;
+            }
+        }
+        return true;
+    }
+
+    long long chunk_length(long long c) const {
+        return std::min((long long)RESUME_CHUNK, (long long)info.length - c * RESUME_CHUNK);
+    }
+
+    // 条带中 [pos, pos + len) 已写入 (重复的包由调用方去掉)
+    void add(long long pos, int len) {
+        while (len > 0) {
+            long long c = pos / RESUME_CHUNK;
+            int k = (int)std::min((long long)len, (c + 1) * RESUME_CHUNK - pos);
+            filled[c] += k;
+            if (filled[c] == chunk_length(c)) {
+                bitmap[c / 8] |= (uint8_t)(1 << (c % 8));
+                missing--;
+            }
+            pos += k;
+            len -= k;
+        }
+    }
+
+    // 先写临时文件再替换,保存到一半时退出也不会留下损坏的断点文件
+    bool save() const {
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write((const char*)&info, sizeof(info));
+            out.write((const char*)bitmap.data(), bitmap.size());
+            if (!out) return false;
+        }
+        return MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+    }
+
+    void remove_file() const {
+        std::remove(path.c_str());
+    }
+};
+
+#endif // RESUME_H
@@ -0,0 +1,141 @@
+#ifndef RTO_TIMER_H
+#define RTO_TIMER_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <climits>
+
+// 重传超时 (RTO) 估计,按 RFC 6298 计算
+// 只用没有重传过的包的 RTT 作为样本 (Karn 算法),超时后 RTO 加倍,拿到新样本后重新计算.
+// 单位均为微秒.
+struct RttEstimator {
+    double srtt = 0;                // 平滑 RTT
+    double rttvar = 0;              // RTT 偏差
+    long long rto;                  // 当前重传超时
+    long long minRto;
+    long long maxRto;
+    bool hasSample = false;
+
+    RttEstimator(long long initialUs, long long minUs, long long maxUs)
+        : rto(initialUs), minRto(minUs), maxRto(maxUs) {}
+
+    void sample(long long rttUs) {
+        double r = (double)rttUs;
+        if (!hasSample) {
+            srtt = r;                   // 第一个样本: SRTT = R, RTTVAR = R/2
+            rttvar = r / 2;
+            hasSample = true;
+        } else {
+            rttvar = 0.75 * rttvar + 0.25 * (srtt > r ? srtt - r : r - srtt);
+            srtt = 0.875 * srtt + 0.125 * r;
+        }
+        rto = clamp((long long)(srtt + std::max(1000.0, 4 * rttvar)));    // 时钟粒度按 1ms 计
+    }
+
+    // 超时后指数退避
+    void backoff() {
+        rto = clamp(rto * 2);
+    }
+
+    long long clamp(long long v) const {
+        return std::min(maxRto, std::max(minRto, v));
+    }
+};
+
+// 哈希时间轮
+// 每个在途的包登记一个定时器,按到期的时间片 (tick) 放进 deadline % SLOTS 号槽位,登记和到期都是 O(1),
+// 不需要每轮扫描整个窗口. 包被确认或重发后不去删除旧定时器,而是在到期时用 sendId 判断是否已经失效.
+// 发送循环每轮都要问最近的到期时间:用非空槽位的位图跳过空槽位,每个槽位记下其中最早的到期 tick,
+// 不必逐个查看槽位和其中的定时器.
+struct TimerWheel {
+    static const int SLOTS = 2048;  // 槽位数,超过一圈的定时器留在槽中等下一圈
+    static const int WORDS = SLOTS / 64;
+
+    struct Entry {
+        long long index;            // 包的索引
+        uint32_t sendId;            // 登记时包的发送次数,不一致说明定时器已失效
+        long long deadline;         // 到期的 tick
+    };
+
+    std::vector<std::vector<Entry>> slots;
+    std::vector<long long> slotMin; // 每个槽位中最早的到期 tick,空槽位为 LLONG_MAX
+    uint64_t nonEmpty[WORDS] = {};  // 非空槽位的位图
+    long long current = 0;          // 已经处理到的 tick
+    size_t pending = 0;             // 轮中的定时器数 (含已失效的)
+
+    TimerWheel() : slots(SLOTS), slotMin(SLOTS, LLONG_MAX) {}
+
+    void schedule(long long index, uint32_t sendId, long long deadline) {
+        if (deadline <= current) deadline = current + 1;
+        int s = (int)(deadline % SLOTS);
+        slots[s].push_back({index, sendId, deadline});
+        slotMin[s] = std::min(slotMin[s], deadline);
+        nonEmpty[s / 64] |= 1ULL << (s % 64);
+        pending++;
+    }
+
+    // 最近一个定时器到期的 tick,没有定时器时返回 -1 (已失效的定时器也算,提前醒来一次无害)
+    long long next_deadline() const {
+        if (pending == 0) return -1;
+        // 从 current + 1 起按时间顺序查看非空槽位,第一个有本圈到期的定时器的槽位就是答案
+        for (int d = 0; d < SLOTS; d++) {
+            int k = next_nonempty((int)((current + 1 + d) % SLOTS));
+            if (k < 0 || d + k >= SLOTS) break;
+            d += k;
+            long long t = current + 1 + d;
+            if (slotMin[t % SLOTS] <= t) return t;
+        }
+        return current + SLOTS;     // 都在一圈之外,一圈后再检查
+    }
+
+    // 推进到 now,把到期的定时器放入 expired (调用方再判断是否失效)
+    void advance(long long now, std::vector<Entry>& expired) {
+        if (now <= current) return;
+        // 长时间没有推进时最多扫一圈
+        long long start = std::max(current + 1, now - SLOTS + 1);
+        for (long long t = start; t <= now && pending > 0; t++) {
+            int s = (int)(t % SLOTS);
+            std::vector<Entry>& slot = slots[s];
+            if (slot.empty()) continue;
+            long long earliest = LLONG_MAX;
+            for (size_t i = 0; i < slot.size();) {
+                if (slot[i].deadline <= now) {
+                    expired.push_back(slot[i]);
+                    slot[i] = slot.back();      // 与最后一个交换后删除,O(1)
+                    slot.pop_back();
+                    pending--;
+                } else {
+                    earliest = std::min(earliest, slot[i].deadline);
+                    i++;
+                }
+            }
+            slotMin[s] = earliest;
+            if (slot.empty()) {
+                nonEmpty[s / 64] &= ~(1ULL << (s % 64));
+            }
+        }
+        current = now;
+    }
+
+private:
+    // 从槽位 s (含) 起按环形顺序到下一个非空槽位的距离,没有非空槽位时返回 -1
+    int next_nonempty(int s) const {
+        for (int k = 0; k <= WORDS; k++) {
+            int w = (s / 64 + k) % WORDS;
+            uint64_t bits = nonEmpty[w];
+            if (k == 0) {
+                bits &= ~0ULL << (s % 64);
+            } else if (k == WORDS) {
+                bits &= (1ULL << (s % 64)) - 1;     // 绕回第一个字中 s 之前的部分
+            }
+            if (bits) {
+                int slot = w * 64 + __builtin_ctzll(bits);
+                return (slot - s + SLOTS) % SLOTS;
+            }
+        }
+        return -1;
+    }
+};
+
+#endif // RTO_TIMER_H
@@ -1,365 +1,1708 @@
-#include "rdt.h"
-#include <fstream>
-#include <iomanip>
-#include <cstdlib>
-#include <ctime>
-#include <thread>
-
-using namespace std;
-
-// 全局变量
-SOCKET sock;
-sockaddr_in serverAddr;
-int addrLen = sizeof(serverAddr);
-double packetLossRate = 0.0; // 丢包率 (0.0 - 1.0)
-int maxWindowSize = 20;      // 最大发送窗口大小 (默认20)
-int delayMs = 0;             // 模拟延时 (毫秒)
-
-// RENO 状态
-enum RenoState {
-    SLOW_START,                     // 慢启动
-    CONGESTION_AVOIDANCE,           // 拥塞避免
-    FAST_RECOVERY                   // 快速恢复
-};
-
-// 发送缓冲区中的包结构
-struct SenderPacket {
-    Packet pkt;         // 数据包
-    bool acked;         // 是否被确认
-    bool sent;          // 是否已发送
-    chrono::steady_clock::time_point sendTime; // 发送时间,用于超时检测
-};
-
-vector<SenderPacket> packets;   // 发送缓冲区,索引对应包的序列号减1(从 0 开始，而 seq 从 1 开始)
-double cwnd = 1.0;              // 拥塞窗口，代表“发送方觉得网络能承受多少包”
-int ssthresh = 16;              // 慢启动阈值
-int dupAckCount = 0;            // 重复 ACK 计数器,用于快速重传
-RenoState state = SLOW_START;
-
-// 发送窗口变量
-int base = 0;                   // 已确认的包的下一个索引(滑动窗口左边界)
-int nextSeqNum = 0;             // 下一个要发送的包的索引(滑动窗口右边界)
-
-// 统计信息
-int totalBytesSent = 0;
-auto startTime = chrono::steady_clock::now();
-
-// 发送单个数据包
-// seq_index: 包在 packets 中的索引
-void send_packet(int seq_index) {
-    if (seq_index >= packets.size()) return;
-    
-    SenderPacket& sp = packets[seq_index];
-
-    // 模拟丢包 (仅针对数据包，不丢握手包)
-    // 如果概率< packetLossRate则模拟丢包
-    if (packetLossRate > 0.0 && ((rand() % 1000) / 1000.0 < packetLossRate)) {
-        // cout << "[Simulated Loss] Packet " << sp.pkt.header.seq << " dropped." << endl;
-        // 即使“丢包”，逻辑上也认为尝试发送了，只是没调用 sendto
-        if (!sp.sent) {
-            sp.sent = true;
-            sp.sendTime = chrono::steady_clock::now();
-        }
-        return;
-    }
-
-    sp.pkt.header.checksum = 0;
-    sp.pkt.header.checksum = calculate_checksum(&sp.pkt);
-    
-    // 模拟网络延时
-    if (delayMs > 0) {
-        this_thread::sleep_for(chrono::milliseconds(delayMs));
-    }
-
-    sendto(sock, (char*)&sp.pkt, sizeof(PacketHeader) + sp.pkt.header.length, 0, (sockaddr*)&serverAddr, addrLen);
-    
-    sp.sent = true;
-    sp.sendTime = chrono::steady_clock::now();
-    // print_packet_info("SEND", sp.pkt); // 调试输出
-}
-
-// 握手
-bool handshake() {
-    Packet synPkt;
-    memset(&synPkt, 0, sizeof(synPkt));
-    synPkt.header.flags = FLAG_SYN;
-    synPkt.header.seq = 0;              // 初始序列号设置为0
-    synPkt.header.length = 0;
-    synPkt.header.checksum = calculate_checksum(&synPkt);
-
-    // 发送 SYN
-    sendto(sock, (char*)&synPkt, sizeof(PacketHeader), 0, (sockaddr*)&serverAddr, addrLen);
-    cout << "[Handshake] SYN sent." << endl;
-
-    // 等待 SYN + ACK
-    Packet recvPkt;
-    fd_set readfds;             // 文件描述符集合,用于 select 函数,监控套接字的可读状态
-    timeval tv;                 // 超时设置
-    tv.tv_sec = 2;              // 2秒超时
-    tv.tv_usec = 0;             // 微秒部分设置为0
-
-    FD_ZERO(&readfds);          // 清空集合
-    FD_SET(sock, &readfds);     // 将套接字加入集合,以监控其可读状态
-
-    // select 等待,它的作用是“带超时的等待”.如果 2 秒内没收到服务器的回复，select 就会返回 0，握手失败,避免程序死锁。
-    int ret = select(0, &readfds, NULL, NULL, &tv);
-
-    if (ret > 0) {
-        int len = recvfrom(sock, (char*)&recvPkt, sizeof(recvPkt), 0, (sockaddr*)&serverAddr, &addrLen);
-        if (len > 0 && (recvPkt.header.flags & (FLAG_SYN | FLAG_ACK))) {
-            if (calculate_checksum(&recvPkt) == recvPkt.header.checksum) {
-                cout << "[Handshake] SYN+ACK received." << endl;
-                
-                // 发送 ACK
-                Packet ackPkt;
-                memset(&ackPkt, 0, sizeof(ackPkt));
-                ackPkt.header.flags = FLAG_ACK;
-                ackPkt.header.seq = 1;                          // 客户端初始序列号为1
-                ackPkt.header.ack = recvPkt.header.seq + 1;     // 确认号为服务器初始序列号+1
-                ackPkt.header.length = 0;
-                ackPkt.header.checksum = calculate_checksum(&ackPkt);
-                
-                sendto(sock, (char*)&ackPkt, sizeof(PacketHeader), 0, (sockaddr*)&serverAddr, addrLen);
-                cout << "[Handshake] ACK sent. Connection Established." << endl;
-                return true;
-            }
-        }
-    }
-    
-    cout << "[Handshake] Failed." << endl;
-    return false;
-}
-
-// 读取文件并打包
-void load_file(const string& filename) {
-    ifstream file(filename, ios::binary);       // 以二进制模式打开文件
-    if (!file.is_open()) {
-        cerr << "Failed to open file: " << filename << endl;
-        exit(1);
-    }
-
-    file.seekg(0, ios::end);               // file.seekg 用于设置输入流的读取位置,这里将读取位置移动到文件末尾
-    int fileSize = file.tellg();           // file.tellg 用于获取当前读取位置的偏移量,这里获取的是文件大小
-    file.seekg(0, ios::beg);               // 将读取位置移动回文件开头
-
-    int seq = 1; // 数据包序列号从1开始
-    while (file.tellg() < fileSize) {
-        SenderPacket sp;
-        memset(&sp, 0, sizeof(sp));
-        sp.pkt.header.seq = seq++;          // 序列号从1开始递增
-        sp.pkt.header.flags = 0; // 普通数据包
-        sp.acked = false;
-        sp.sent = false;
-
-        int remaining = fileSize - (int)file.tellg();   // 剩余未读字节数
-        int len = min(MSS, remaining);                  // 本次读取的字节数不超过 MSS 和剩余字节数
-        file.read(sp.pkt.data, len);                    // 读取数据到包的 data 部分,长度为 len
-        sp.pkt.header.length = len;                     // 设置包的长度字段为len
-        
-        packets.push_back(sp);                          // 将打包好的数据包加入发送缓冲区
-    }
-    file.close();
-    cout << "File loaded. Total packets: " << packets.size() << endl;
-}
-
-// 挥手,关闭连接
-void teardown() {
-    Packet finPkt;
-    memset(&finPkt, 0, sizeof(finPkt));
-    finPkt.header.flags = FLAG_FIN;
-    finPkt.header.seq = packets.size() + 1;     // FIN 包的序列号在发送的最后一个数据包之后
-    finPkt.header.length = 0;
-    finPkt.header.checksum = calculate_checksum(&finPkt);
-
-    sendto(sock, (char*)&finPkt, sizeof(PacketHeader), 0, (sockaddr*)&serverAddr, addrLen);
-    cout << "[Teardown] FIN sent." << endl;
-
-    // 简单等待 ACK
-    Packet recvPkt;
-    timeval tv = {2, 0};
-    fd_set readfds;
-    FD_ZERO(&readfds);
-    FD_SET(sock, &readfds);
-    
-    if (select(0, &readfds, NULL, NULL, &tv) > 0) {
-        recvfrom(sock, (char*)&recvPkt, sizeof(recvPkt), 0, (sockaddr*)&serverAddr, &addrLen);
-        if (recvPkt.header.flags & FLAG_ACK) {
-            cout << "[Teardown] ACK received. Connection Closed." << endl;
-        }
-    }
-}
-
-int main(int argc, char* argv[]) {
-    srand(time(0)); // 初始化随机种子
-
-    if (argc < 4) {
-        cout << "Usage: " << argv[0] << " <server_ip> <server_port> <file_path> [loss_rate] [window_size] [delay_ms]" << endl;
-        cout << "Example: " << argv[0] << " 127.0.0.1 8080 data.txt 0.1 20 100" << endl;
-        return 1;
-    }
-
-    string serverIp = argv[1];                  // 服务器 IP 地址
-    int serverPort = atoi(argv[2]);             // 服务器端口
-    string filePath = argv[3];                  // 发送文件路径
-    if (argc >= 5) {                            // 可选参数:丢包率
-        packetLossRate = atof(argv[4]);
-        cout << "Packet Loss Rate set to: " << packetLossRate << endl;
-    }
-    if (argc >= 6) {                            // 可选参数:窗口大小
-        maxWindowSize = atoi(argv[5]);
-        cout << "Max Window Size set to: " << maxWindowSize << endl;
-    }
-    if (argc >= 7) {                            // 可选参数:延时
-        delayMs = atoi(argv[6]);
-        cout << "Delay set to: " << delayMs << " ms" << endl;
-    }
-
-    // 初始化 Winsock
-    WSADATA wsaData;
-    WSAStartup(MAKEWORD(2, 2), &wsaData);
-
-    sock = socket(AF_INET, SOCK_DGRAM, 0);
-
-    serverAddr.sin_family = AF_INET;                // 地址族:IPv4
-    serverAddr.sin_port = htons(serverPort);        // 主机字节序转换为网络字节序(大端)
-    // 使用 inet_addr 替代 inet_pton 以兼容 MinGW
-    serverAddr.sin_addr.s_addr = inet_addr(serverIp.c_str());       // 服务器 IP 地址
-
-    if (!handshake()) {
-        closesocket(sock);
-        WSACleanup();
-        return 1;
-    }
-
-    // 读取并打包文件
-    load_file(filePath);                    
-    
-    // 记录开始时间
-    startTime = chrono::steady_clock::now();
-
-    // 主循环：发送和接收
-    while (base < packets.size()) {
-        // 1. 发送窗口内的包
-        int windowSize = min((int)cwnd, maxWindowSize);             // 计算当前窗口大小，取拥塞窗口和最大窗口的较小值
-        // 发送窗口内未发送的包,直到达到窗口上限
-        while (nextSeqNum < packets.size() && nextSeqNum < base + windowSize) {
-            if (!packets[nextSeqNum].sent) {
-                send_packet(nextSeqNum);
-            }
-            nextSeqNum++;
-        }
-
-        // 2. 接收 ACK
-        fd_set readfds;
-        FD_ZERO(&readfds);
-        FD_SET(sock, &readfds);
-        timeval tv = {0, 10000}; // 10ms 超时,这里的10ms代表等待ACK的时间间隔
-
-        int ret = select(0, &readfds, NULL, NULL, &tv);
-        if (ret > 0) {
-            Packet recvPkt;
-            sockaddr_in fromAddr;
-            int fromLen = sizeof(fromAddr);
-            int len = recvfrom(sock, (char*)&recvPkt, sizeof(recvPkt), 0, (sockaddr*)&fromAddr, &fromLen);
-            
-            if (len > 0 && (recvPkt.header.flags & FLAG_ACK)) {
-                if (calculate_checksum(&recvPkt) == recvPkt.header.checksum) {
-                    int ackSeq = recvPkt.header.ack;        // 接收端返回的是它收到的包的序列号(SR选择确认)
-                    int ackIndex = ackSeq - 1;              // 索引号为序列号减1
-
-                    // 如果该包在窗口范围内,那么标记为已确认
-                    if (ackIndex >= base && ackIndex < packets.size()) {
-                        if (!packets[ackIndex].acked) {
-                            packets[ackIndex].acked = true;
-                            
-                            if (ackIndex == base) {
-                                // 收到 Base 的 ACK，滑动窗口
-                                while (base < packets.size() && packets[base].acked) {
-                                    base++;
-                                }
-                                
-                                // RENO: 收到新数据的 ACK
-                                if (state == FAST_RECOVERY) {
-                                    // 标准 RENO: 收到新数据的 ACK，退出快速恢复 (Deflation)
-                                    // 将 cwnd 恢复为 ssthresh
-                                    cwnd = (double)ssthresh;
-                                    state = CONGESTION_AVOIDANCE;
-                                    dupAckCount = 0;
-                                } else {
-                                    // 正常状态下的 ACK 处理
-                                    dupAckCount = 0;
-                                    if (state == SLOW_START) {
-                                        cwnd += 1.0;                // 每收到一个 ACK，窗口加 1
-                                        if (cwnd >= ssthresh) {
-                                            state = CONGESTION_AVOIDANCE;
-                                        }
-                                    } else if (state == CONGESTION_AVOIDANCE) {
-                                        cwnd += 1.0 / cwnd;         // 每收到一个 ACK，窗口加 1/cwnd
-                                    }
-                                }
-                            } else {
-                                // 收到乱序 ACK (SACK) -> 视为重复 ACK
-                                if (state == FAST_RECOVERY) {
-                                    // 标准 RENO: 快速恢复期间，每收到一个重复 ACK，cwnd 加 1 (允许发送新数据)
-                                    cwnd += 1.0;
-                                } else {
-                                    dupAckCount++;
-                                    if (dupAckCount == 3) {
-                                        // 快速重传
-                                        cout << "[Fast Retransmit] Packet " << packets[base].pkt.header.seq << endl;
-                                        send_packet(base); // 重传 Base
-
-                                        // 进入快速恢复
-                                        ssthresh = max(2, (int)cwnd / 2);   // 阈值减半
-                                        cwnd = ssthresh + 3;                // 快速恢复阶段，拥塞窗口设置为阈值加3
-                                        state = FAST_RECOVERY;              // 显式进入快速恢复状态
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
-
-        // 3. 处理超时
-        if (base < packets.size()) {
-            auto now = chrono::steady_clock::now();
-            auto duration = chrono::duration_cast<chrono::milliseconds>(now - packets[base].sendTime).count();
-            if (packets[base].sent && duration > TIMEOUT_MS) {
-                cout << "[Timeout] Packet " << packets[base].pkt.header.seq << endl;
-                send_packet(base); // 重传 Base
-                
-                // RENO 超时处理
-                ssthresh = max(2, (int)cwnd / 2);
-                cwnd = 1.0;                 // 重置为1
-                state = SLOW_START;         // 重新进入慢启动阶段
-                dupAckCount = 0;
-            }
-        }
-        
-        // 简单的流量控制显示
-        // cout << "\rBase: " << base << " Cwnd: " << cwnd << " Ssthresh: " << ssthresh << flush;
-    }
-
-    auto endTime = chrono::steady_clock::now();
-    auto totalTimeUs = chrono::duration_cast<chrono::microseconds>(endTime - startTime).count();
-    double totalTimeSec = totalTimeUs / 1000000.0;      // 除以一百万转换为秒(microseconds转为seconds)
-    
-    // 计算吞吐率 (Bytes / Second) -> MB/s
-    // 估算总传输数据量 = 包数量 * 数据长度 (忽略重传的开销，计算有效吞吐率 Goodput)
-    long long totalBytes = 0;
-    for(const auto& p : packets) totalBytes += p.pkt.header.length;
-    
-    double throughput = (double)totalBytes / 1024.0 / 1024.0 / totalTimeSec;        // MB/s
-    
-    cout << endl << "Transfer Complete!" << endl;
-    cout << "Time: " << totalTimeSec << " s" << endl;
-    cout << "Throughput: " << throughput << " MB/s" << endl;
-
-    teardown();
-
-    closesocket(sock);
-    WSACleanup();
-    return 0;
-}
+#include "rdt.h"
+#include "udp_batch.h"
+#include "rto_timer.h"
+#include "congestion.h"
+#include "pacer.h"
+#include "event_loop.h"
+#include "spsc_ring.h"
+#include "ack_bitmap.h"
+#include "transport_stats.h"
+#include "fec.h"
+#include "compress.h"
+#include "session.h"
+#include "resume.h"
+#include "digest.h"
+#include <fstream>
+#include <iomanip>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <functional>
+#include <cstdio>
+#include <io.h>                     // _setmode()
+#include <fcntl.h>                  // _O_BINARY
+
+using namespace std;
+
+// 全局配置 (所有条带共用)
+double packetLossRate = 0.0; // 丢包率 (0.0 - 1.0)
+int maxWindowSize = 20;      // 最大发送窗口大小 (默认20)
+int delayMs = 0;             // 模拟延时 (毫秒)
+int requestedMss = MSS;      // 希望使用的分段大小,握手时发给接收端
+bool useGso = false;         // 是否启用 UDP 发送分段卸载 (USO)
+bool usePacing = false;      // true: 按速率均匀发送; false: 窗口一打开就突发发送
+string ccName = "reno";      // 拥塞控制算法
+int txCore = -1;             // 发送线程固定到的 CPU 核,-1 表示不固定 (第 i 个条带依次后移 2 个核)
+int ackCore = -1;            // ACK 线程固定到的 CPU 核
+bool useCompress = false;    // 请求压缩数据 (--compress),接收端同意后才启用
+int compressThreads = 0;     // 压缩工作线程数,0 表示按 CPU 核数在条带间平分
+bool useResume = false;      // 请求断点续传 (--resume):接收端有这个文件的断点时只发送缺失的块
+int fecBlock = 0;            // FEC 分组大小 (--fec):每这么多个新数据包发一个校验包;0 不启用,-1 按观测到的丢包率自适应
+uint32_t isn = 0;            // 初始序列号 (SYN 的序列号),第 i 个数据包的序列号为 isn + i + 1 (回绕);取接近 2^32 的值可以测试回绕
+mutex logMutex;              // 多个条带线程同时输出时保证每行完整
+string statsPath;            // 统计输出文件 (--stats),为空时不采样时间序列
+int statsIntervalMs = 10;    // 时间序列的采样间隔 (毫秒)
+int statsDumpMs = 0;         // 传输过程中每隔多久把统计写一次文件 (毫秒),0 表示只在结束时写
+
+// 发送缓冲区中的包结构
+// 只保存头部和指向数据的指针,数据本身留在文件映射(或读入的文件缓冲区)中,发送时用分散/聚集 I/O 拼成一个数据报
+struct SenderPacket {
+    PacketHeader header; // 数据包头部
+    const char* data;   // 数据部分,指向文件内容中偏移 (seq-1)*segSize 处
+    bool counted;       // 发送线程是否已处理过它的确认 (计入拥塞控制和 RTT);接收端是否收到以 ackMap 为准
+    bool sent;          // 是否已发送
+    bool fastRetx;      // 是否已经被快速重传过 (每个包只快速重传一次,再丢只能等超时)
+    bool retransmitted; // 是否重传过,重传过的包不能作为 RTT 样本 (Karn 算法)
+    uint32_t sendId;    // 发送次数,用于判断时间轮中的定时器是否已经失效
+    long long fecEnd;   // 所在 FEC 分组的结束索引 (不含),不在分组中时为 0
+    chrono::steady_clock::time_point sendTime; // 最近一次发送的时间,用于计算 RTT
+};
+
+// 文件数据源 (各条带共用同一份文件内容)
+bool useMmap = false;           // true: 内存映射文件(零拷贝); false: 一次性读入 fileBuffer
+vector<char> fileBuffer;        // 读取模式下的文件内容
+HANDLE fileHandle = INVALID_HANDLE_VALUE;   // 映射模式下的文件句柄
+HANDLE mapHandle = NULL;        // 映射模式下的文件映射对象
+const char* fileData = nullptr; // 文件内容的起始地址 (映射视图或 fileBuffer)
+long long fileSize = 0;         // 文件大小
+bool streamMode = false;        // true: 从流 (标准输入/管道) 中边读边发,只支持一个条带; false: 文件模式
+const long long READ_LIMIT = 1LL << 30;     // 超过 1 GB 的文件不再一次性读入内存,自动改用映射
+
+// 多文件会话:file_path 是目录或 "@列表文件" 时,在一个连接中依次发送所有文件 (见 session.h)
+bool sessionMode = false;
+vector<SessionFile> sessionFiles;
+
+// 条带传输:文件被切成 streamCount 段连续的条带,每段用一个独立的连接 (端口 port+i) 发送,
+// 各自有发送线程、ACK 线程和拥塞控制,互不等待
+int streamCount = 1;
+const long long STRIPE_ALIGN = 64 * 1024;   // 条带边界按 64 KB 对齐,接收端的写入块不会跨条带
+
+const long long PERSIST_MAX_US = 500000;    // 零窗口探测间隔上限 (微秒)
+
+// 还原为 64 位序列号的 SACK 块 [start, end)
+struct SeqRange {
+    long long start;
+    long long end;
+};
+
+// ACK 线程解析后交给发送线程的 ACK,序列号都已还原为从 1 开始的 64 位序列号 (包索引加 1)
+struct AckRecord {
+    long long ack;                      // 累计确认号 (FLAG_SACK) 或收到的那个包的序列号 (旧版接收端)
+    uint8_t flags;
+    uint8_t blockCount;
+    uint16_t window;                    // 接收端通告的窗口 (flags 带 FLAG_WND 时有效)
+    uint32_t recovered;                 // 接收端由 FEC 还原的包数 (启用 FEC 时放在 ACK 的 seq 字段)
+    SeqRange blocks[MAX_SACK_BLOCKS];
+};
+
+// 重传定时器和节拍使用的时间起点 (所有条带共用)
+auto timerEpoch = chrono::steady_clock::now();
+
+// 当前时间对应的时间片 (毫秒)
+inline long long current_tick() {
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - timerEpoch).count();
+}
+
+// 当前时间 (微秒),与时间轮使用同一个起点
+inline long long current_us() {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - timerEpoch).count();
+}
+
+// 一个 RDT 连接 (一个条带) 的全部发送状态,由它自己的发送线程和 ACK 线程使用
+struct SenderConnection {
+    int id = 0;                     // 条带编号
+    SOCKET sock = INVALID_SOCKET;
+    sockaddr_in serverAddr;
+    int addrLen = sizeof(sockaddr_in);
+    uint32_t connId = 0;            // 连接 ID,每个包的头部都带上,接收端据此把同一端口上的多个连接分开
+    int segSize = MSS;              // 握手协商出的分段大小,每个数据包的数据部分 (最后一个包除外) 都是这么大
+    long long offset = 0;           // 本条带在文件中的起始偏移
+    long long length = 0;           // 本条带的字节数 (流模式下边读边累加)
+
+    // 发送缓冲区:在途的包不超过 maxWindowSize 个,放在同样大小的环形缓冲区中,索引 i 的包在 ring[i % ring.size()].
+    // 包索引从 0 开始 (序列号减 1),是不回绕的 64 位整数;内存占用只与窗口大小有关,与文件大小无关.
+    // 文件模式下包将要发送时才填写槽位 (数据指针指向文件内容);流模式下由读线程读入数据后填写
+    vector<SenderPacket> ring;
+    long long packetCount = 0;      // 文件模式的总包数
+
+    // 流式数据源 (标准输入/管道):总长度事先未知,由读线程按需读入环形缓冲区
+    vector<char> ringData;          // 环形缓冲区各槽位的数据存储,每个槽位 segSize 字节
+    atomic<long long> readCount{0}; // 读线程已经读入的包数量 (索引小于它的包都可以发送)
+    atomic<bool> streamEof{false};  // 读线程已读到流末尾,readCount 即为总包数
+    long long ringBase = 0;         // 读线程看到的窗口左边界,受 ringMutex 保护
+    mutex ringMutex;
+    condition_variable ringCv;      // 窗口滑动时通知读线程有空槽位
+    condition_variable dataCv;      // 读入新包或读到流末尾时通知发送线程
+    thread readerThread;
+    bool streaming = false;         // 包由读线程按需产生 (流模式,或启用了压缩),否则直接由文件内容切分
+
+    // 压缩:读线程从流水线读取压缩后的字节流,像流模式一样切成满的分段
+    bool compressActive = false;    // 指定了 --compress 且接收端在 SYN+ACK 中同意
+    CompressPipeline compressor;
+    long long sourcePos = 0;        // 文件模式下流水线在本条带中读到的位置
+
+    // 多文件会话:读线程从 session 读取记录和文件内容,像流模式一样切成满的分段
+    bool sessionActive = false;     // 会话模式且接收端在 SYN+ACK 中同意
+    SessionSource session;
+
+    // 断点续传:接收端在握手中给出已有块的位图,包只对缺失的区间编号 (见 resume.h)
+    bool resumed = false;
+    ResumeMap resumeMap;
+    long long resumeSkipped = 0;    // 接收端已有而不必发送的字节数
+
+    // 端到端摘要:切分数据时顺带计算 (压缩前的数据),挥手时与接收端写入时算出的摘要比较
+    Crc32c digest;
+    int digestStatus = 0;           // 0: 接收端没有给出摘要 (旧版接收端或确认丢失); 1: 一致; -1: 不一致
+
+    // 拥塞控制:算法由 --cc 选择,发送端只负责记分板和丢包恢复
+    CongestionControl* cc = nullptr;
+    int dupAckCount = 0;            // 重复 ACK 计数器 (没有推进窗口左边界的 ACK)
+    bool inRecovery = false;        // 是否处于快速恢复
+    long long deliveredCount = 0;   // 累计确认的包数,供基于速率的算法估计带宽
+    long long recoveryPoint = 0;    // 进入快速恢复时的 nextSeqNum,窗口左边界越过它才退出快速恢复
+    long long highestAcked = -1;    // 已确认 (含 SACK) 的最大包索引,用于判断空洞是否丢失
+    static const int DUP_THRESH = 3;    // 空洞之后有这么多个包已被确认,就认为空洞中的包丢了 (相当于 3 个重复 ACK)
+
+    // 发送窗口变量
+    long long base = 0;             // 已确认的包的下一个索引(滑动窗口左边界)
+    long long nextSeqNum = 0;       // 下一个要发送的包的索引(滑动窗口右边界)
+
+    // 流量控制:接收端在 ACK 中通告还能接收多少个包,在途的包不超过这个窗口,不会因为接收端跟不上而白白丢包
+    long long peerWindowEnd = -1;   // 接收端允许发送的包索引上界 (不含),-1 表示接收端不通告窗口 (旧版接收端)
+    long long peerWindowAck = 0;    // 上次更新窗口的 ACK 的累计确认号,乱序到达的旧 ACK 不能把窗口改回去
+    long long persistUs = -1;       // 下一次零窗口探测的时间,-1 表示不在零窗口状态
+    long long persistIntervalUs = 0;    // 零窗口探测的间隔,每次探测后加倍
+
+    // 批量收发
+    UdpSendBatch sendBatch;         // 一轮中要发送的数据包先放入这里,每轮结束时一起发出
+    UdpRecvBatch ackBatch;          // 一次取走所有已到达的 ACK (ACK 线程使用)
+    static const int ACK_BURST = 64;    // 每次最多处理的 ACK 数
+    Packet ackPkts[ACK_BURST];      // ACK 接收缓冲区
+    Packet* ackBufs[ACK_BURST];
+
+    // ACK 线程:专门收取和校验 ACK,发送线程在 sleep (模拟延时) 或阻塞在发送上时 ACK 照样被及时读走
+    // 解析后的 ACK 经无锁单生产者单消费者队列交给发送线程,同时立即在原子位图中标记已确认的包
+    AckBitmap ackMap;                       // 每个包是否已被接收端确认 (按包索引)
+    SpscRing<AckRecord, 1024> ackRing;      // ACK 线程 -> 发送线程
+    atomic<long long> sentLimit{0};         // 发送过的包的索引上界,ACK 线程只标记这之前的包
+    atomic<bool> ackStop{false};
+    EventLoop ackLoop;                      // 等待套接字可读 (ACK 线程;握手和挥手时由发送线程使用)
+    thread ackThread;
+
+    // 重传定时
+    RttEstimator rtt{TIMEOUT_MS * 1000LL, RTO_MIN_MS * 1000LL, RTO_MAX_MS * 1000LL};
+    TimerWheel timers;                          // 每个在途的包一个定时器,时间片为 1ms
+    vector<TimerWheel::Entry> expiredTimers;    // 本轮到期的定时器
+
+    // 发送节拍
+    Pacer pacer;
+
+    // 前向纠错:每 K 个新数据包之后发一个校验包,接收端能自己还原组内丢失的一个包
+    bool fecActive = false;         // 指定了 --fec 且接收端在 SYN+ACK 中同意
+    FecEncoder fec;
+    double fecLoss = 0;             // 估计的丢包率 (自适应分组大小时使用)
+    long long fecSentMark = 0;      // 上次估计丢包率时的 nextSeqNum
+    long long fecLostMark = 0;      // 上次估计丢包率时的丢包数
+    long long peerRecovered = 0;    // 接收端报告的由 FEC 还原的包数
+    long long paritySent = 0;       // 发出的校验包数
+    static const int FEC_SAMPLE_PACKETS = 256;  // 每发出这么多个新包更新一次丢包率估计
+
+    // 事件循环:ACK 线程交来新的 ACK 或下一个截止时间 (重传定时器 / 发送节拍) 到达时才唤醒发送线程
+    EventLoop loop;
+    static const long long TIMER_SPIN_US = 1000;    // 没有高精度定时器时,距下一个发送时间不足 1ms 就不再等待 (计时精度不够),而是轮询
+
+    // 统计信息
+    long long retransmissions = 0;              // 重传次数 (含模拟丢包后的重传)
+    long long fastRetransmits = 0;              // 其中由记分板判定丢失后快速重传的次数
+    long long timeouts = 0;                     // 超时事件数 (同一轮中多个包超时算一次)
+    long long timeoutRetransmits = 0;           // 因超时重传的包数
+    long long dupAcks = 0;                      // 没有推进窗口左边界的 ACK 数
+    long long simulatedDrops = 0;               // 模拟丢包丢掉的包数
+    long long zeroWindowProbes = 0;             // 发出的零窗口探测数
+    atomic<long long> checksumDrops{0};         // 校验和错误被丢弃的 ACK 数 (ACK 线程累加)
+    long long latestRttUs = -1;                 // 最近一个 RTT 样本
+    long long startUs = 0;                      // 传输开始的时间 (current_us),时间序列以此为零点
+    long long nextDumpUs = 0;                   // 下一次定期写统计文件的时间
+    StatsRecorder stats;                        // cwnd / ssthresh / 状态 / 在途包数 / RTT 的时间序列
+    chrono::steady_clock::time_point startTime;
+    chrono::steady_clock::time_point endTime;
+    bool ok = false;                            // 传输是否完成
+
+    SenderConnection() {
+        for (int k = 0; k < ACK_BURST; k++) ackBufs[k] = &ackPkts[k];
+    }
+
+    SenderPacket& packet_at(long long index);
+    long long packets_ready();
+    bool transfer_done();
+    bool open(const string& serverIp, int serverPort);
+    void mark_sent(SenderPacket& sp, long long seq_index);
+    void send_packet(long long seq_index);
+    void fill_packet(long long index);
+    int fec_block_size();
+    void fec_add(long long index);
+    void send_parity();
+    int loss_threshold(long long index);
+    long long unwrap(uint32_t wire, long long ref);
+    bool handshake();
+    bool fetch_resume_bitmap(uint32_t size, vector<uint8_t>& bitmap);
+    void load_packets();
+    void notify_stream_data();
+    void wait_stream_data();
+    void stream_reader(const function<size_t(char*, size_t)>& read);
+    void open_stream(const string& filename);
+    void release_stream_slots();
+    void teardown();
+    int mark_acked(long long from, long long to, long long& rttUs);
+    bool is_acked(long long index);
+    int retransmit_lost();
+    bool has_lost_packet();
+    void process_ack(const AckRecord& rec);
+    void update_pacing_rate();
+    void send_window_probe();
+    void handle_timeouts();
+    void record_sample(bool force = false);
+    StatsCounters counters();
+    void dump_stats();
+    void mark_bitmap(long long from, long long to, long long limit);
+    void ack_receiver();
+    void transmit();
+    void run(const string& filePath);
+    void cleanup();
+};
+
+// 按索引取包:文件模式直接取 packets,流模式取环形缓冲区中的槽位
+inline SenderPacket& SenderConnection::packet_at(long long index) {
+    return ring[index % ring.size()];
+}
+
+// 已经可以发送的包数量:文件模式为总包数,流模式为读线程已读入的包数
+inline long long SenderConnection::packets_ready() {
+    return streaming ? readCount.load(memory_order_acquire) : packetCount;
+}
+
+// 所有数据包是否都已确认 (流模式下还要求已读到流末尾)
+inline bool SenderConnection::transfer_done() {
+    if (streaming) {
+        return streamEof.load(memory_order_acquire) && base >= readCount.load(memory_order_acquire);
+    }
+    return base >= packetCount;
+}
+
+// 记录一次发送:更新发送时间,并在时间轮中为这次发送登记重传定时器
+void SenderConnection::mark_sent(SenderPacket& sp, long long seq_index) {
+    if (sp.sent) {
+        sp.retransmitted = true;
+        retransmissions++;
+    }
+    if (usePacing) {
+        pacer.on_send(current_us());        // 重传同样占用发送额度
+    }
+    sp.sent = true;
+    sp.sendTime = chrono::steady_clock::now();
+    sp.sendId++;
+    timers.schedule(seq_index, sp.sendId, current_tick() + (rtt.rto + 999) / 1000);
+}
+
+// 发送单个数据包
+// seq_index: 包的索引 (序列号减1)
+void SenderConnection::send_packet(long long seq_index) {
+    if (seq_index >= packets_ready()) return;
+    
+    SenderPacket& sp = packet_at(seq_index);
+
+    // 模拟丢包 (仅针对数据包，不丢握手包)
+    // 如果概率< packetLossRate则模拟丢包
+    if (packetLossRate > 0.0 && ((rand() % 1000) / 1000.0 < packetLossRate)) {
+        // cout << "[Simulated Loss] Packet " << sp.pkt.header.seq << " dropped." << endl;
+        simulatedDrops++;
+        // 即使“丢包”，逻辑上也认为尝试发送了，只是没调用 sendto
+        mark_sent(sp, seq_index);
+        return;
+    }
+
+    sp.header.checksum = 0;
+    sp.header.checksum = calculate_checksum(&sp.header, sp.data);
+    
+    // 模拟网络延时
+    if (delayMs > 0) {
+        this_thread::sleep_for(chrono::milliseconds(delayMs));
+    }
+
+    // 分散/聚集发送:头部来自 SenderPacket,数据直接来自文件内容,不再拷贝到连续的 Packet 中
+    // 这里只是放入批量发送队列,由主循环在一轮结束时统一 flush
+    sendBatch.add(sp.header, sp.data, serverAddr);
+    mark_sent(sp, seq_index);
+    // cout << "[SEND] Seq: " << sp.header.seq << " Len: " << sp.header.length << endl; // 调试输出
+}
+
+// 握手
+bool SenderConnection::handshake() {
+    Packet synPkt;
+    memset(&synPkt, 0, sizeof(synPkt));
+    synPkt.header.flags = FLAG_SYN;
+    if (fecBlock != 0) {
+        synPkt.header.flags |= FLAG_FEC;    // 请求使用 FEC,旧版接收端不认识这个标志,不会在 SYN+ACK 中带回
+    }
+    if (useCompress) {
+        synPkt.header.flags |= FLAG_COMPRESS;
+    }
+    if (sessionMode) {
+        synPkt.header.flags |= FLAG_SESSION;
+    }
+    if (useResume) {
+        synPkt.header.flags |= FLAG_RESUME;
+    }
+    synPkt.header.seq = isn;            // 初始序列号 (默认为 0)
+    synPkt.header.connId = connId;
+    SynOptions* opts = (SynOptions*)synPkt.data;
+    opts->mss = requestedMss;           // 提议的分段大小
+    StripeOptions* stripe = (StripeOptions*)(synPkt.data + sizeof(SynOptions));
+    stripe->offset = (uint64_t)offset;  // 本条带在文件中的起始偏移,接收端据此定位写入
+    synPkt.header.length = sizeof(SynOptions) + sizeof(StripeOptions);
+    if (useResume) {
+        // 文件大小和条带长度,接收端据此判断断点文件是否属于这个文件
+        ResumeOptions* resume = (ResumeOptions*)(synPkt.data + synPkt.header.length);
+        resume->fileSize = (uint64_t)fileSize;
+        resume->length = (uint64_t)length;
+        synPkt.header.length += sizeof(ResumeOptions);
+    }
+    synPkt.header.checksum = calculate_checksum(&synPkt);
+
+    // 发送 SYN
+    sendto(sock, (char*)&synPkt, sizeof(PacketHeader) + synPkt.header.length, 0, (sockaddr*)&serverAddr, addrLen);
+    {
+        lock_guard<mutex> lock(logMutex);
+        cout << "[Handshake] SYN sent." << endl;
+    }
+
+    // 等待 SYN + ACK
+    Packet recvPkt;
+
+    // 带超时的等待:回复一到达就被唤醒;如果 2 秒内没收到服务器的回复，握手失败,避免程序死锁。
+    if (ackLoop.wait(-1, 2000) == EventLoop::READABLE) {
+        int len = recvfrom(sock, (char*)&recvPkt, sizeof(recvPkt), 0, (sockaddr*)&serverAddr, &addrLen);
+        if (len > 0 && (recvPkt.header.flags & (FLAG_SYN | FLAG_ACK)) && (recvPkt.header.connId == 0 || recvPkt.header.connId == connId)) {
+            if (calculate_checksum(&recvPkt) == recvPkt.header.checksum) {
+                // 接收端回复协商后的分段大小,旧版接收端不带选项,使用默认值
+                segSize = MSS;
+                if (recvPkt.header.length >= sizeof(SynOptions)) {
+                    segSize = ((SynOptions*)recvPkt.data)->mss;
+                }
+                if (segSize < 1 || segSize > requestedMss) {
+                    segSize = min(MSS, requestedMss);
+                }
+                // 接收端的初始窗口:序列号 1 .. window 的包可以发送
+                if (recvPkt.header.flags & FLAG_WND) {
+                    peerWindowEnd = recvPkt.header.window;
+                }
+                // 接收端同意使用 FEC;校验包缓冲区比一批的最大包数多一个,flush 之前不会被覆盖
+                fecActive = fecBlock != 0 && (recvPkt.header.flags & FLAG_FEC);
+                if (fecActive) {
+                    fec.init(segSize, UdpSendBatch::MAX_BATCH + 1);
+                }
+                compressActive = useCompress && (recvPkt.header.flags & FLAG_COMPRESS);
+                sessionActive = sessionMode && (recvPkt.header.flags & FLAG_SESSION);
+                // 接收端有断点:取回位图,只对缺失的块编号
+                if (useResume && (recvPkt.header.flags & FLAG_RESUME) && recvPkt.header.length >= sizeof(SynOptions) + sizeof(ResumeReply)) {
+                    uint32_t size = ((ResumeReply*)(recvPkt.data + sizeof(SynOptions)))->bitmapBytes;
+                    vector<uint8_t> bitmap;
+                    if (!fetch_resume_bitmap(size, bitmap)) {
+                        lock_guard<mutex> lock(logMutex);
+                        cout << "[Handshake] Failed to fetch the resume bitmap." << endl;
+                        return false;
+                    }
+                    resumeMap.build(bitmap, length, segSize);
+                    resumeSkipped = length - resumeMap.bytes;
+                    resumed = true;
+                }
+                // 发送 ACK
+                Packet ackPkt;
+                memset(&ackPkt, 0, sizeof(ackPkt));
+                ackPkt.header.flags = FLAG_ACK;
+                ackPkt.header.seq = isn + 1;                    // 第一个数据包的序列号
+                ackPkt.header.connId = connId;
+                ackPkt.header.ack = recvPkt.header.seq + 1;     // 确认号为服务器初始序列号+1
+                ackPkt.header.length = 0;
+                ackPkt.header.checksum = calculate_checksum(&ackPkt);
+                
+                sendto(sock, (char*)&ackPkt, sizeof(PacketHeader), 0, (sockaddr*)&serverAddr, addrLen);
+                lock_guard<mutex> lock(logMutex);
+                cout << "[Handshake] SYN+ACK received. Segment size: " << segSize << endl;
+                if (fecBlock != 0 && !fecActive) {
+                    cout << "[Handshake] Receiver does not support FEC, sending without parity." << endl;
+                }
+                if (useCompress && !compressActive) {
+                    cout << "[Handshake] Receiver does not support compression, sending raw data." << endl;
+                }
+                if (resumed) {
+                    cout << "[Handshake] Resuming: receiver already has " << resumeSkipped << " of " << length << " bytes." << endl;
+                } else if (useResume) {
+                    cout << "[Handshake] Receiver has no checkpoint for this file, sending all of it." << endl;
+                }
+                cout << "[Handshake] ACK sent. Connection Established. Connection ID: " << conn_id_str(connId) << endl;
+                return true;
+            }
+        }
+    }
+    
+    lock_guard<mutex> lock(logMutex);
+    cout << "[Handshake] Failed." << (streamCount > 1 ? " Stripe " + to_string(id) : "") << endl;
+    return false;
+}
+
+// 握手中逐段取回接收端的位图:每段一个请求,超时重发
+bool SenderConnection::fetch_resume_bitmap(uint32_t size, vector<uint8_t>& bitmap) {
+    bitmap.assign(size, 0);
+    uint32_t pos = 0;
+    int attempts = 0;
+    while (pos < size) {
+        if (++attempts > 5) {
+            return false;
+        }
+        Packet req;
+        memset(&req, 0, sizeof(req));
+        req.header.flags = FLAG_RESUME;
+        req.header.seq = pos;
+        req.header.connId = connId;
+        req.header.checksum = calculate_checksum(&req);
+        sendto(sock, (char*)&req, sizeof(PacketHeader), 0, (sockaddr*)&serverAddr, addrLen);
+
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(500);
+        while (true) {
+            long long left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+            if (left <= 0 || ackLoop.wait(-1, (DWORD)left) != EventLoop::READABLE) {
+                break;
+            }
+            Packet reply;
+            ackLoop.reset_socket();
+            int len = recvfrom(sock, (char*)&reply, sizeof(reply), 0, (sockaddr*)&serverAddr, &addrLen);
+            if (len < HEADER_SIZE || reply.header.length > len - HEADER_SIZE || calculate_checksum(&reply) != reply.header.checksum) {
+                continue;
+            }
+            if ((reply.header.flags & FLAG_RESUME) && !(reply.header.flags & FLAG_SYN) && reply.header.seq == pos) {
+                uint32_t k = min((uint32_t)reply.header.length, size - pos);
+                memcpy(&bitmap[pos], reply.data, k);
+                pos += k;
+                attempts = 0;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+// 映射文件:把整个文件映射到进程地址空间,数据在发送时由操作系统按需从页缓存中取出
+bool map_file(const string& filename) {
+    fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);   // 提示系统顺序预读
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(fileHandle, &size)) {
+        return false;
+    }
+    fileSize = size.QuadPart;
+    if (fileSize == 0) {
+        return true;                        // 空文件无法创建映射,也不需要映射
+    }
+
+    mapHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapHandle == NULL) {
+        return false;
+    }
+    fileData = (const char*)MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);     // 长度为0表示映射整个文件
+    return fileData != nullptr;
+}
+
+// 读取文件:一次性读入连续的缓冲区 (不支持映射时的普通模式)
+bool read_file(const string& filename) {
+    // 大文件一次性读入需要同样大的内存,改为映射 (需要 64 位程序才能映射超过 2 GB 的文件)
+    ifstream probe(filename, ios::binary | ios::ate);
+    if (probe.is_open() && (long long)probe.tellg() > READ_LIMIT) {
+        cout << "File is larger than " << (READ_LIMIT >> 20) << " MB, mapping it instead of reading it into memory." << endl;
+        useMmap = true;
+        return map_file(filename);
+    }
+    probe.close();
+
+    ifstream file(filename, ios::binary);       // 以二进制模式打开文件
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file.seekg(0, ios::end);               // file.seekg 用于设置输入流的读取位置,这里将读取位置移动到文件末尾
+    fileSize = file.tellg();               // file.tellg 用于获取当前读取位置的偏移量,这里获取的是文件大小
+    file.seekg(0, ios::beg);               // 将读取位置移动回文件开头
+
+    fileBuffer.resize(fileSize);
+    file.read(fileBuffer.data(), fileSize);
+    fileData = fileBuffer.data();
+    return true;
+}
+
+// 读取文件 (映射或读入),各条带共用同一份文件内容
+void load_file(const string& filename) {
+    bool ok = useMmap ? map_file(filename) : read_file(filename);
+    if (!ok) {
+        cerr << "Failed to open file: " << filename << endl;
+        exit(1);
+    }
+}
+
+// 列出会话要发送的文件:目录递归列出 (相对路径以目录名开头);"@列表文件" 每行一个文件或目录
+// 列表中的相对路径原样作为接收端的路径,绝对路径只保留文件名
+void load_session(const string& spec) {
+    vector<string> entries;
+    if (spec[0] == '@') {
+        ifstream list(spec.substr(1));
+        if (!list.is_open()) {
+            cerr << "Failed to open file list: " << spec.substr(1) << endl;
+            exit(1);
+        }
+        string line;
+        while (getline(list, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) entries.push_back(line);
+        }
+    } else {
+        entries.push_back(spec);
+    }
+
+    for (string path : entries) {
+        replace(path.begin(), path.end(), '\\', '/');
+        while (path.size() > 1 && path.back() == '/') path.pop_back();
+        string name = path;
+        if (name.compare(0, 2, "./") == 0) name = name.substr(2);
+        if (name[0] == '/' || name.find(':') != string::npos || name.find("..") != string::npos) {
+            name = name.substr(name.find_last_of("/:") + 1);
+        }
+        if (is_directory(path)) {
+            list_files(path, name == "." ? "" : name + "/", sessionFiles);
+            continue;
+        }
+        ifstream f(path, ios::binary | ios::ate);
+        if (!f.is_open()) {
+            cerr << "Skipping unreadable file: " << path << endl;
+            continue;
+        }
+        sessionFiles.push_back({path, name, (uint64_t)f.tellg(), false});
+    }
+}
+
+// 把本条带 [offset, offset + length) 切分成包:只计算包数并分配窗口大小的环形缓冲区,
+// 每个包在将要发送时由 fill_packet() 填写头部和数据位置,数据本身不拷贝
+void SenderConnection::load_packets() {
+    packetCount = resumed ? resumeMap.packets : (length + segSize - 1) / segSize;
+    ring.assign(maxWindowSize, SenderPacket());
+    lock_guard<mutex> lock(logMutex);
+    if (streamCount > 1) {
+        cout << "Stripe " << id << ": offset " << offset << ", " << length << " bytes, " << packetCount << " packets." << endl;
+    } else {
+        cout << "File loaded" << (useMmap ? " (mmap)" : "") << ". Total packets: " << packetCount << endl;
+    }
+}
+
+// 文件模式:为索引 index 的包填写槽位 (槽位原来的包在窗口左边界之前,已经确认)
+void SenderConnection::fill_packet(long long index) {
+    SenderPacket& sp = packet_at(index);
+    memset(&sp.header, 0, sizeof(sp.header));
+    sp.header.seq = (uint32_t)(isn + index + 1);    // 数据包序列号从 isn + 1 开始,超过 32 位时回绕
+    sp.header.connId = connId;
+    sp.header.flags = 0;                            // 普通数据包
+    if (resumed) {
+        long long pos;
+        int len;
+        resumeMap.locate(index, pos, len);          // 续传时只有缺失的区间,每个区间的最后一个包可能不满
+        sp.header.length = (uint16_t)len;
+        sp.data = fileData + offset + pos;
+    } else {
+        sp.header.length = (uint16_t)min((long long)segSize, length - index * segSize);   // 最后一个包可能不足 segSize
+        sp.data = fileData + offset + index * segSize;
+    }
+    digest.update(sp.data, sp.header.length);      // 每个包只在第一次发送前填写一次,按索引顺序
+    sp.counted = false;
+    sp.sent = false;
+    sp.fastRetx = false;
+    sp.retransmitted = false;
+    sp.sendId = 0;
+    sp.fecEnd = 0;
+}
+
+// 把 ACK 中的 32 位序列号还原为从 1 开始的 64 位序列号 (包索引加 1),ref 为附近一个已知的 64 位序列号
+inline long long SenderConnection::unwrap(uint32_t wire, long long ref) {
+    return seq_unwrap(wire - isn, ref);
+}
+
+// 释放文件数据源
+void unload_file() {
+    if (fileData && useMmap) UnmapViewOfFile(fileData);
+    if (mapHandle) CloseHandle(mapHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+    fileData = nullptr;
+    mapHandle = NULL;
+    fileHandle = INVALID_HANDLE_VALUE;
+    vector<char>().swap(fileBuffer);
+}
+
+// 通知主线程有新数据 (先获取一次锁,避免主线程检查条件后、进入等待前错过通知)
+void SenderConnection::notify_stream_data() {
+    { lock_guard<mutex> lock(ringMutex); }
+    dataCv.notify_one();
+}
+
+// 主线程:窗口内的包都已确认而读线程还没读入新包时,等待新数据而不是空等 ACK
+void SenderConnection::wait_stream_data() {
+    unique_lock<mutex> lock(ringMutex);
+    dataCv.wait(lock, [this] {
+        return readCount.load(memory_order_acquire) > nextSeqNum || streamEof.load(memory_order_acquire);
+    });
+}
+
+// 读线程:从数据源逐段读满 segSize 字节放入环形缓冲区,与主线程的发送并行进行
+// 环形缓冲区满 (已读入的包超出窗口左边界 ring.size() 个) 时等待主线程滑动窗口
+// read 像 fread 一样一直读到 n 字节或数据结束,保证除最后一个包外每个包都是满的
+void SenderConnection::stream_reader(const function<size_t(char*, size_t)>& read) {
+    long long index = 0;
+    while (true) {
+        {
+            unique_lock<mutex> lock(ringMutex);
+            ringCv.wait(lock, [&] { return index < ringBase + (long long)ring.size(); });
+        }
+
+        SenderPacket& sp = ring[index % ring.size()];
+        char* buf = &ringData[(index % ring.size()) * segSize];
+        size_t len = read(buf, segSize);
+        if (len == 0) {
+            break;
+        }
+
+        memset(&sp.header, 0, sizeof(sp.header));
+        sp.header.seq = (uint32_t)(isn + index + 1);
+        sp.header.connId = connId;
+        sp.header.length = (uint16_t)len;
+        sp.data = buf;
+        sp.counted = false;
+        sp.sent = false;
+        sp.fastRetx = false;
+        sp.retransmitted = false;
+        sp.sendId = 0;
+        sp.fecEnd = 0;
+        if (!compressActive) {
+            length += len;              // 压缩时 length 为原始数据的字节数,传输结束时由流水线给出
+        }
+        readCount.store(++index, memory_order_release);     // 发布该包,主线程此后才能访问这个槽位
+        notify_stream_data();
+
+        if (len < (size_t)segSize) {
+            break;
+        }
+    }
+    streamEof.store(true, memory_order_release);
+    notify_stream_data();
+}
+
+// 打开流式数据源并启动读线程,"-" 表示标准输入
+// 会话模式下数据源是各文件的记录首尾相接的字节流
+// 启用压缩时读线程改从压缩流水线读取;文件模式下流水线直接读取本条带的文件内容
+void SenderConnection::open_stream(const string& filename) {
+    FILE* in = nullptr;
+    function<size_t(char*, size_t)> source;
+    if (sessionActive) {
+        session.start(sessionFiles);
+        source = [this](char* buf, size_t n) { return session.read(buf, n); };
+    } else if (streamMode) {
+        in = stdin;
+        if (filename == "-") {
+            _setmode(_fileno(stdin), _O_BINARY);   // Windows 下标准输入默认是文本模式,会改写 \r\n 和 0x1A
+        } else {
+            in = fopen(filename.c_str(), "rb");
+            if (!in) {
+                cerr << "Failed to open file: " << filename << endl;
+                exit(1);
+            }
+        }
+        source = [in](char* buf, size_t n) { return fread(buf, 1, n, in); };
+    } else {
+        source = [this](char* buf, size_t n) {
+            size_t k = (size_t)min((long long)n, length - sourcePos);
+            memcpy(buf, fileData + offset + sourcePos, k);
+            sourcePos += k;
+            return k;
+        };
+    }
+
+    // 摘要按压缩前的数据计算,与接收端解压后写入的数据一致
+    function<size_t(char*, size_t)> raw = source;
+    source = [this, raw](char* buf, size_t n) {
+        size_t k = raw(buf, n);
+        digest.update(buf, k);
+        return k;
+    };
+
+    int threads = compressThreads;
+    if (compressActive) {
+        if (threads <= 0) {
+            threads = max(1, (int)thread::hardware_concurrency() / streamCount);
+        }
+        compressor.start(source, threads);
+        source = [this](char* buf, size_t n) { return compressor.read(buf, n); };
+    }
+
+    ring.resize(maxWindowSize);
+    ringData.resize((size_t)maxWindowSize * segSize);
+    readerThread = thread([this, in, source] {
+        stream_reader(source);
+        if (compressActive) compressor.stop();
+        if (in && in != stdin) fclose(in);
+    });
+    lock_guard<mutex> lock(logMutex);
+    if (streamMode) {
+        cout << "Streaming input from " << (filename == "-" ? "stdin" : filename) << ", buffer " << maxWindowSize << " packets." << endl;
+    }
+    if (compressActive && id == 0) {
+        cout << "Compressing " << COMPRESS_BLOCK / 1024 << " KB blocks with " << threads << " worker threads"
+             << (streamCount > 1 ? " per stripe" : "") << "." << endl;
+    }
+}
+
+// 窗口滑动后通知读线程,被确认的槽位可以复用
+void SenderConnection::release_stream_slots() {
+    if (!streaming) return;
+    {
+        lock_guard<mutex> lock(ringMutex);
+        ringBase = base;
+    }
+    ringCv.notify_one();
+}
+
+// 挥手,关闭连接
+void SenderConnection::teardown() {
+    Packet finPkt;
+    memset(&finPkt, 0, sizeof(finPkt));
+    finPkt.header.flags = FLAG_FIN;
+    finPkt.header.seq = (uint32_t)(isn + packets_ready() + 1);  // FIN 包的序列号在发送的最后一个数据包之后
+    finPkt.header.connId = connId;
+    DigestOptions* sent = (DigestOptions*)finPkt.data;     // 本端的摘要,接收端据此判断写入的数据是否完好
+    sent->crc32c = digest.value();
+    sent->bytes = digest.bytes;
+    finPkt.header.length = sizeof(DigestOptions);
+    finPkt.header.checksum = calculate_checksum(&finPkt);
+
+    sendto(sock, (char*)&finPkt, sizeof(PacketHeader) + finPkt.header.length, 0, (sockaddr*)&serverAddr, addrLen);
+    {
+        lock_guard<mutex> lock(logMutex);
+        cout << "[Teardown] FIN sent." << endl;
+    }
+
+    // 简单等待 ACK (最多 2 秒),先取走还留在套接字中的数据 ACK
+    Packet recvPkt;
+    memset(&recvPkt, 0, sizeof(recvPkt));
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(2);
+    while (true) {
+        ackLoop.reset_socket();
+        int len = recvfrom(sock, (char*)&recvPkt, sizeof(recvPkt), 0, (sockaddr*)&serverAddr, &addrLen);
+        if (len > 0 && (recvPkt.header.flags & FLAG_ACK) && recvPkt.header.ack == finPkt.header.seq + 1) {
+            break;                      // 确认 FIN 的 ACK
+        }
+        if (len > 0) {
+            continue;                   // 迟到的数据 ACK
+        }
+        long long left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+        if (left <= 0 || ackLoop.wait(-1, (DWORD)left) != EventLoop::READABLE) {
+            return;
+        }
+    }
+    lock_guard<mutex> lock(logMutex);
+    cout << "[Teardown] ACK received. Connection Closed." << endl;
+
+    // 新版接收端在确认中带回它写入时算出的摘要
+    if (recvPkt.header.length >= sizeof(DigestOptions) && recvPkt.header.length <= MSS &&
+        calculate_checksum(&recvPkt) == recvPkt.header.checksum) {
+        DigestOptions* got = (DigestOptions*)recvPkt.data;
+        digestStatus = got->crc32c == sent->crc32c && got->bytes == sent->bytes ? 1 : -1;
+        if (digestStatus < 0) {
+            cout << "[Digest] Mismatch" << (streamCount > 1 ? " on stripe " + to_string(id) : "") << ": sent CRC32C "
+                 << digest_str(sent->crc32c) << " over " << sent->bytes << " bytes, receiver wrote "
+                 << digest_str(got->crc32c) << " over " << got->bytes << " bytes." << endl;
+        }
+    }
+}
+
+// 把索引 [from, to) 中尚未确认的包标记为已确认,返回新确认的包数
+// 得到 RTT 样本时写入 rttUs
+int SenderConnection::mark_acked(long long from, long long to, long long& rttUs) {
+    from = max(from, (long long)base);
+    to = min(to, (long long)nextSeqNum);
+    int count = 0;
+    bool hasSample = false;
+    chrono::steady_clock::time_point latestSend;
+    for (long long i = from; i < to; i++) {
+        SenderPacket& sp = packet_at(i);
+        if (!sp.counted) {
+            sp.counted = true;
+            count++;
+            // Karn 算法:只用没有重传过的包计算 RTT,取最近发出的那个 (最能反映这个 ACK 的往返时间)
+            if (!sp.retransmitted && (!hasSample || sp.sendTime > latestSend)) {
+                latestSend = sp.sendTime;
+                hasSample = true;
+            }
+        }
+    }
+    if (count > 0) {
+        highestAcked = max(highestAcked, to - 1);
+    }
+    if (hasSample) {
+        rttUs = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - latestSend).count();
+        rtt.sample(rttUs);
+    }
+    deliveredCount += count;
+    return count;
+}
+
+// 包是否已被确认:发送线程已处理过,或 ACK 线程已经标记 (对应的 ACK 还在队列中)
+inline bool SenderConnection::is_acked(long long index) {
+    return packet_at(index).counted || ackMap.test(index);
+}
+
+// 根据记分板重传丢失的包:一个未确认的包之后若已有 DUP_THRESH 个包被确认,就认为它丢了
+// 每个包只快速重传一次,返回重传的包数
+int SenderConnection::retransmit_lost() {
+    int retransmitted = 0;
+    int ackedAbove = 0;
+    for (long long i = highestAcked; i >= base; i--) {
+        SenderPacket& sp = packet_at(i);
+        if (is_acked(i)) {
+            ackedAbove++;
+        } else if (ackedAbove >= loss_threshold(i) && sp.sent && !sp.fastRetx) {
+            {
+                lock_guard<mutex> lock(logMutex);
+                cout << "[Fast Retransmit] Packet " << i + 1 << endl;
+            }
+            send_packet(i);
+            sp.fastRetx = true;
+            fastRetransmits++;
+            retransmitted++;
+        }
+    }
+    return retransmitted;
+}
+
+// 窗口左边界之后有没有被判定为丢失的包
+bool SenderConnection::has_lost_packet() {
+    int ackedAbove = 0;
+    for (long long i = highestAcked; i >= base; i--) {
+        if (is_acked(i)) {
+            ackedAbove++;
+        } else if (ackedAbove >= loss_threshold(i) && !packet_at(i).fastRetx) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 空洞之后要有多少个包已被确认才认为它丢了
+// 在 FEC 分组中的包还可能由接收端还原,要等组内它之后的包 (和紧跟其后的校验包) 都有机会到达,
+// 所以阈值再加上组内排在它后面的包数,否则校验包还没到,发送端就已经快速重传并把拥塞窗口减半了
+inline int SenderConnection::loss_threshold(long long index) {
+    long long fecEnd = packet_at(index).fecEnd;
+    return fecEnd > index ? DUP_THRESH + (int)(fecEnd - index - 1) : DUP_THRESH;
+}
+
+// 处理一个 ACK (发送线程)
+// 带 FLAG_SACK 的 ACK:ack 为累计确认号,另有 SACK 块,一个 ACK 就能更新整个记分板;
+// 不带 FLAG_SACK 的 ACK (旧版接收端):ack 为收到的那个包的序列号,相当于只有一个 SACK 块
+void SenderConnection::process_ack(const AckRecord& rec) {
+    int newlyAcked = 0;
+    long long rttUs = -1;
+    if (rec.flags & FLAG_SACK) {
+        newlyAcked += mark_acked(base, rec.ack - 1, rttUs);                // 累计确认:序列号小于 ack 的包
+        for (int i = 0; i < rec.blockCount; i++) {
+            newlyAcked += mark_acked(rec.blocks[i].start - 1, rec.blocks[i].end - 1, rttUs);
+        }
+    } else {
+        long long ackIndex = rec.ack - 1;                                  // 索引号为序列号减1
+        newlyAcked += mark_acked(ackIndex, ackIndex + 1, rttUs);
+    }
+
+    if (fecActive) {
+        peerRecovered = max(peerRecovered, (long long)rec.recovered);
+    }
+
+    // 接收窗口:以累计确认号最大的 ACK 为准
+    if ((rec.flags & FLAG_WND) && rec.ack >= peerWindowAck) {
+        peerWindowAck = rec.ack;
+        peerWindowEnd = rec.ack - 1 + rec.window;
+    }
+
+    // 滑动窗口
+    long long oldBase = base;
+    while (base < nextSeqNum && packet_at(base).counted) {
+        base++;
+    }
+    bool advanced = base > oldBase;
+    if (advanced) {
+        release_stream_slots();
+    }
+
+    if (advanced) {
+        dupAckCount = 0;
+        // 恢复点之前的包都已确认:退出快速恢复
+        // 部分确认时保持快速恢复,由下面的 retransmit_lost() 继续重传剩下的空洞
+        if (inRecovery && base >= recoveryPoint) {
+            inRecovery = false;
+            cc->on_recovery_exit();
+        }
+    } else {
+        dupAckCount++;                  // 没有推进窗口左边界 -> 视为重复 ACK
+        dupAcks++;
+    }
+
+    // 交给拥塞控制算法 (按新确认的包数计算,延迟确认时一个 ACK 可能确认多个包)
+    AckSample sample;
+    sample.newlyAcked = newlyAcked;
+    sample.advanced = advanced;
+    sample.inRecovery = inRecovery;
+    sample.rttUs = rttUs;
+    sample.srttUs = (long long)rtt.srtt;
+    sample.inflight = nextSeqNum - base;
+    sample.delivered = deliveredCount;
+    sample.nowUs = current_us();
+    cc->on_ack(sample);
+    if (rttUs >= 0) {
+        latestRttUs = rttUs;
+    }
+
+    // 记分板显示有包丢失:进入快速恢复 (每个恢复期只通知一次拥塞控制)
+    if (!inRecovery && has_lost_packet()) {
+        inRecovery = true;
+        recoveryPoint = nextSeqNum;
+        cc->on_loss();
+        record_sample(true);            // cwnd 的每次下降都记录下来
+    }
+    if (inRecovery) {
+        retransmit_lost();
+    }
+}
+
+// 由拥塞控制的状态计算发送速率:算法自己给出速率 (BBR) 时直接使用,
+// 否则按 cwnd / SRTT 把一个窗口分布到一个 RTT 内,慢启动时乘 2、拥塞避免时乘 1.25,以免节拍本身限制窗口增长
+void SenderConnection::update_pacing_rate() {
+    double rate = cc->pacing_rate();
+    if (rate <= 0 && rtt.hasSample && rtt.srtt > 0) {
+        double window = min(cc->window(), (double)maxWindowSize);
+        double gain = cc->window() < cc->slow_start_threshold() ? 2.0 : 1.25;
+        rate = gain * window * 1e6 / rtt.srtt;
+    }
+    pacer.set_rate(rate);                   // 还没有 RTT 样本时为 0,不限速
+}
+
+// 零窗口探测:接收端通告的窗口为 0 且没有在途的包时,不会再有 ACK 带来窗口更新,
+// 万一接收端主动发出的窗口更新丢了,就靠探测包让接收端再回复一次当前窗口
+void SenderConnection::send_window_probe() {
+    PacketHeader probe;
+    memset(&probe, 0, sizeof(probe));
+    probe.flags = FLAG_ACK | FLAG_WND;
+    probe.seq = (uint32_t)(isn + nextSeqNum + 1);
+    probe.connId = connId;
+    probe.checksum = calculate_checksum(&probe, nullptr);
+    sendBatch.add(probe, nullptr, serverAddr);
+    zeroWindowProbes++;
+}
+
+// 新分组的大小:固定值 (--fec k),或按最近的丢包率自适应
+// 丢包数 = 重传的包数 + 接收端还原的包数 (被 FEC 还原的包不会重传,只算重传会低估丢包率)
+int SenderConnection::fec_block_size() {
+    if (fecBlock > 0) {
+        return fecBlock;
+    }
+    if (nextSeqNum - fecSentMark >= FEC_SAMPLE_PACKETS) {
+        long long lost = fastRetransmits + timeoutRetransmits + peerRecovered;
+        double sample = (double)(lost - fecLostMark) / (nextSeqNum - fecSentMark);
+        fecLoss = fecSentMark == 0 ? sample : 0.75 * fecLoss + 0.25 * sample;
+        fecSentMark = nextSeqNum;
+        fecLostMark = lost;
+    }
+    return fec_block_for_loss(fecLoss);
+}
+
+// 把第一次发送的包加入当前分组 (没有进行中的分组时开始一个新分组),在头部中填上分组信息
+void SenderConnection::fec_add(long long index) {
+    if (fec.size == 0) {
+        int k = fec_block_size();
+        if (k == 0) {
+            return;                     // 丢包率很低,这个包不加保护
+        }
+        if (!streaming) {
+            k = (int)min((long long)k, packetCount - index);
+        }
+        fec.begin(index, k);
+    }
+    SenderPacket& sp = packet_at(index);
+    sp.header.ack = (uint32_t)(isn + fec.start + 1);
+    sp.header.window = (uint16_t)fec.size;
+    sp.fecEnd = fec.start + fec.size;
+    fec.add(sp.data, sp.header.length);
+}
+
+// 发出当前分组的校验包 (与数据包一样经过模拟丢包),重传时不再发送
+void SenderConnection::send_parity() {
+    PacketHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.flags = FLAG_FEC;
+    hdr.seq = (uint32_t)(isn + fec.start + 1);
+    hdr.ack = fec.lengthXor;
+    hdr.window = (uint16_t)fec.count;
+    hdr.length = (uint16_t)fec.maxLength;
+    hdr.connId = connId;
+    const char* data = fec.finish();
+    paritySent++;
+    if (packetLossRate > 0.0 && ((rand() % 1000) / 1000.0 < packetLossRate)) {
+        simulatedDrops++;
+        return;
+    }
+    hdr.checksum = calculate_checksum(&hdr, data);
+    sendBatch.add(hdr, data, serverAddr);
+}
+
+// 处理到期的重传定时器
+// 同一轮中有多个包超时只算一次超时事件:RTO 退避一次,拥塞窗口也只重置一次
+void SenderConnection::handle_timeouts() {
+    expiredTimers.clear();
+    timers.advance(current_tick(), expiredTimers);
+
+    bool timedOut = false;
+    for (const TimerWheel::Entry& e : expiredTimers) {
+        if (e.index < base || e.index >= nextSeqNum) continue;
+        SenderPacket& sp = packet_at(e.index);
+        if (is_acked(e.index) || sp.sendId != e.sendId) continue;     // 已确认或已重发,定时器失效
+
+        if (!timedOut) {
+            timedOut = true;
+            rtt.backoff();
+            cc->on_timeout();
+            inRecovery = false;
+            dupAckCount = 0;
+            timeouts++;
+            record_sample(true);
+        }
+        timeoutRetransmits++;
+        {
+            lock_guard<mutex> lock(logMutex);
+            cout << "[Timeout] Packet " << e.index + 1 << " (RTO " << rtt.rto / 1000 << " ms)" << endl;
+        }
+        send_packet(e.index);           // 重传超时的包,并以退避后的 RTO 重新登记定时器
+    }
+}
+
+// 记录一个时间序列样本 (只在指定了 --stats 时采样)
+void SenderConnection::record_sample(bool force) {
+    if (statsPath.empty()) return;
+    long long now = current_us();
+    if (!stats.due(now, force)) return;
+    StatsSample s;
+    s.timeUs = now - startUs;
+    s.cwnd = cc->window();
+    s.ssthresh = cc->slow_start_threshold();
+    s.state = cc->state_name();
+    s.inflight = nextSeqNum - base;
+    s.rwnd = peerWindowEnd >= 0 ? peerWindowEnd - base : -1;
+    s.srttUs = rtt.srtt;
+    s.latestRttUs = latestRttUs;
+    s.rtoUs = rtt.rto;
+    s.delivered = deliveredCount;
+    s.retransmits = retransmissions;
+    stats.add(s);
+}
+
+StatsCounters SenderConnection::counters() {
+    return {
+        {"packets_sent", sendBatch.packets},
+        {"bytes_sent", sendBatch.bytes},
+        {"retransmits", retransmissions},
+        {"fast_retransmits", fastRetransmits},
+        {"timeouts", timeouts},
+        {"timeout_retransmits", timeoutRetransmits},
+        {"dup_acks", dupAcks},
+        {"simulated_drops", simulatedDrops},
+        {"zero_window_probes", zeroWindowProbes},
+        {"fec_parity_sent", paritySent},
+        {"fec_recovered", peerRecovered},
+        {"logical_bytes", compressActive ? compressor.rawBytes : length},
+        {"payload_bytes", compressActive ? compressor.outBytes : length},
+        {"session_files", session.filesSent},
+        {"resume_skipped_bytes", resumeSkipped},
+        {"digest_bytes", (long long)digest.bytes},
+        {"ack_checksum_drops", checksumDrops.load(memory_order_relaxed)},
+        {"delivered", deliveredCount},
+    };
+}
+
+// 把计数器和时间序列写到 --stats 指定的文件 (条带传输时每个条带一个文件)
+void SenderConnection::dump_stats() {
+    if (statsPath.empty()) return;
+    string path = stats_path(statsPath, id, streamCount);
+    if (!write_stats(path, string("rdt sender ") + cc->name(), "client", counters(), stats.samples)) {
+        lock_guard<mutex> lock(logMutex);
+        cout << "Failed to write stats to " << path << endl;
+    }
+}
+
+// 把当前线程固定到指定的 CPU 核,core 小于 0 时不固定
+void pin_current_thread(int core, const char* name) {
+    if (core < 0) return;
+    lock_guard<mutex> lock(logMutex);
+    if (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core)) {
+        cout << name << " thread pinned to CPU " << core << "." << endl;
+    } else {
+        cout << "Failed to pin " << name << " thread to CPU " << core << "." << endl;
+    }
+}
+
+// 把 [from, to) 中的包在位图中标记为已确认 (只标记已经发送过的包)
+void SenderConnection::mark_bitmap(long long from, long long to, long long limit) {
+    from = max(from, 0LL);
+    to = min(to, limit);
+    for (long long i = from; i < to; i++) {
+        ackMap.set(i);
+    }
+}
+
+// ACK 线程:套接字可读时取走所有 ACK,校验后先在位图中标记,再放入队列并唤醒发送线程
+void SenderConnection::ack_receiver() {
+    pin_current_thread(ackCore < 0 ? -1 : ackCore + 2 * id, "ACK");
+    long long cumMarked = 0;            // 累计确认部分已经标记到的索引,之后只需标记新增的部分
+    sockaddr_in fromAddrs[ACK_BURST];
+    int ackLens[ACK_BURST];
+    while (!ackStop.load(memory_order_acquire)) {
+        ackLoop.wait(-1, 100);          // 最多等 100ms 再检查是否该退出
+        ackLoop.reset_socket();
+        int ackCount = ackBatch.recv(sock, ackBufs, fromAddrs, ackLens, ACK_BURST, sizeof(Packet), 0);
+        long long limit = sentLimit.load(memory_order_acquire);
+        int published = 0;
+        for (int k = 0; k < ackCount; k++) {
+            Packet& recvPkt = ackPkts[k];
+            int len = ackLens[k];
+            if (len < HEADER_SIZE || !(recvPkt.header.flags & FLAG_ACK) || recvPkt.header.length > len - HEADER_SIZE) {
+                continue;
+            }
+            if (recvPkt.header.connId != 0 && recvPkt.header.connId != connId) {
+                continue;                       // 不是本连接的 ACK (旧版接收端回复的连接 ID 为 0)
+            }
+            if (calculate_checksum(&recvPkt) != recvPkt.header.checksum) {
+                checksumDrops.fetch_add(1, memory_order_relaxed);
+                continue;
+            }
+
+            // ACK 确认的都是已经发出的包,以最后发出的包 (序列号为 limit) 为参照还原 32 位序列号
+            AckRecord rec;
+            rec.ack = unwrap(recvPkt.header.ack, limit);
+            rec.flags = (uint8_t)recvPkt.header.flags;
+            rec.window = recvPkt.header.window;
+            rec.recovered = recvPkt.header.seq;
+            rec.blockCount = 0;
+            if (rec.flags & FLAG_SACK) {
+                long long cum = min(rec.ack - 1, limit);
+                if (cum > cumMarked) {
+                    mark_bitmap(cumMarked, cum, limit);
+                    cumMarked = cum;
+                }
+                rec.blockCount = (uint8_t)min((int)(recvPkt.header.length / sizeof(SackBlock)), MAX_SACK_BLOCKS);
+                const SackBlock* blocks = (const SackBlock*)recvPkt.data;
+                for (int i = 0; i < rec.blockCount; i++) {
+                    rec.blocks[i].start = unwrap(blocks[i].start, limit);
+                    rec.blocks[i].end = unwrap(blocks[i].end, limit);
+                    mark_bitmap(rec.blocks[i].start - 1, rec.blocks[i].end - 1, limit);
+                }
+            } else {
+                mark_bitmap(rec.ack - 1, rec.ack, limit);
+            }
+
+            while (!ackRing.push(rec)) {
+                loop.notify();          // 队列满:催发送线程处理,稍后再试
+                this_thread::yield();
+            }
+            published++;
+        }
+        if (published > 0) {
+            loop.notify();
+        }
+    }
+}
+
+// 创建本连接的套接字和事件循环
+bool SenderConnection::open(const string& serverIp, int serverPort) {
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    set_nonblocking(sock);                          // 批量接收 ACK 时需要非阻塞套接字来判断已经取空
+    if (!ackLoop.init(sock) || !loop.init_notify()) {
+        return false;
+    }
+    sendBatch.init(sock);
+
+    serverAddr.sin_family = AF_INET;                // 地址族:IPv4
+    serverAddr.sin_port = htons(serverPort);        // 主机字节序转换为网络字节序(大端)
+    // 使用 inet_addr 替代 inet_pton 以兼容 MinGW
+    serverAddr.sin_addr.s_addr = inet_addr(serverIp.c_str());       // 服务器 IP 地址
+    cc = create_congestion_control(ccName);
+
+    // 随机选一个非 0 的连接 ID:时间和对象地址混合作为种子 (MinGW 的 random_device 每次返回相同的序列)
+    mt19937 gen((unsigned)(chrono::high_resolution_clock::now().time_since_epoch().count() ^ (uintptr_t)this) + id);
+    do {
+        connId = gen();
+    } while (connId == 0);
+    return true;
+}
+
+// 发送线程的主循环:发送和接收,直到本条带的所有包都已确认
+void SenderConnection::transmit() {
+    while (!transfer_done()) {
+        // 1. 发送窗口内的包 (先攒成一批,循环结束后一次发出)
+        int windowSize = min((int)cc->window(), maxWindowSize);        // 计算当前窗口大小，取拥塞窗口和最大窗口的较小值
+        // 发送窗口内未发送的包,直到达到窗口上限 (启用节拍时还要等到下一个包的发送时间)
+        long long ready = packets_ready();
+        if (usePacing) {
+            update_pacing_rate();
+        }
+        // 发送上界:拥塞窗口和接收端通告的窗口中较小的一个
+        long long sendLimit = base + windowSize;
+        if (peerWindowEnd >= 0) {
+            sendLimit = min(sendLimit, peerWindowEnd);
+        }
+        while (nextSeqNum < ready && nextSeqNum < sendLimit && (!usePacing || pacer.can_send(current_us()))) {
+            if (!streaming) {
+                fill_packet(nextSeqNum);
+            }
+            if (!packet_at(nextSeqNum).sent) {
+                ackMap.ensure(nextSeqNum);
+                sentLimit.store(nextSeqNum + 1, memory_order_release);     // 先发布,ACK 线程才会标记这个包
+                if (fecActive) {
+                    fec_add(nextSeqNum);        // 在计算校验和之前填好分组信息
+                }
+                send_packet(nextSeqNum);
+                if (fec.full()) {
+                    send_parity();
+                }
+            }
+            nextSeqNum++;
+        }
+        // 所有包都已发出 (流模式下已读到流末尾):最后一个分组不满也要发出校验包
+        if (fec.size > 0 && nextSeqNum >= packets_ready() && (!streaming || streamEof.load(memory_order_acquire))) {
+            send_parity();
+        }
+        sendBatch.flush();
+
+        // 流模式下没有在途的包且没有读入的包可发,说明在等读线程,此时没有 ACK 可等
+        if (streaming && base == nextSeqNum && nextSeqNum >= packets_ready()) {
+            wait_stream_data();
+            continue;
+        }
+
+        // 2. 等待事件:ACK 到达、最近的重传定时器到期,或 (启用节拍且窗口还有空位时) 下一个包的发送时间到达
+        // 重传定时器晚一点触发无妨,总是交给定时器等待;只有节拍需要亚毫秒精度,定时器精度不够时改为轮询
+        long long now = current_us();
+        long long waitUs = -1;
+        bool spin = false;
+        long long nextTick = timers.next_deadline();
+        if (nextTick >= 0) {
+            waitUs = max(0LL, nextTick * 1000 - now);
+        }
+        if (usePacing && nextSeqNum < packets_ready() && nextSeqNum < sendLimit) {
+            long long w = pacer.wait_us(now);
+            if (waitUs < 0 || w < waitUs) {
+                waitUs = w;
+                spin = !loop.highResolution && w < TIMER_SPIN_US;
+            }
+        }
+        // 零窗口:没有在途的包,还有包被接收窗口挡住,按退避的间隔探测
+        if (peerWindowEnd >= 0 && base == nextSeqNum && nextSeqNum < packets_ready() && nextSeqNum >= peerWindowEnd) {
+            if (persistUs < 0) {
+                persistIntervalUs = min(rtt.rto, PERSIST_MAX_US);
+                persistUs = now + persistIntervalUs;
+            } else if (now >= persistUs) {
+                send_window_probe();
+                sendBatch.flush();
+                persistIntervalUs = min(persistIntervalUs * 2, PERSIST_MAX_US);
+                persistUs = now + persistIntervalUs;
+            }
+            if (waitUs < 0 || persistUs - now < waitUs) {
+                waitUs = persistUs - now;
+            }
+        } else {
+            persistUs = -1;
+        }
+        if (waitUs != 0 && !spin) {
+            loop.wait(waitUs, RTO_MAX_MS);
+        }
+
+        // 3. 处理 ACK 线程交来的所有 ACK
+        AckRecord rec;
+        while (ackRing.pop(rec)) {
+            process_ack(rec);
+        }
+
+        // 4. 处理超时:从时间轮中取出到期的定时器,重传对应的包 (不再只检查 base)
+        handle_timeouts();
+        sendBatch.flush();                  // 发出本轮的快速重传 / 超时重传
+        
+        // 简单的流量控制显示
+        // cout << "\rBase: " << base << " Cwnd: " << cc->window() << " Ssthresh: " << cc->slow_start_threshold() << flush;
+
+        // 5. 统计:按间隔采样,需要时定期写文件
+        if (!statsPath.empty()) {
+            record_sample();
+            if (statsDumpMs > 0 && current_us() >= nextDumpUs) {
+                dump_stats();
+                nextDumpUs = current_us() + statsDumpMs * 1000LL;
+            }
+        }
+    }
+}
+
+// 一个条带的完整传输:握手、打包、发送、挥手 (在条带自己的线程中运行)
+void SenderConnection::run(const string& filePath) {
+    if (!handshake()) {
+        return;
+    }
+
+    // 套接字发送缓冲区至少要能放下一个窗口的数据
+    int sockBuf = maxWindowSize * (HEADER_SIZE + segSize);
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (char*)&sockBuf, sizeof(sockBuf));
+
+    if (useGso && sendBatch.enable_uso(HEADER_SIZE + segSize) && id == 0) {
+        lock_guard<mutex> lock(logMutex);
+        cout << "UDP send offload enabled, " << HEADER_SIZE + segSize << " bytes per datagram." << endl;
+    } else if (useGso && id == 0) {
+        lock_guard<mutex> lock(logMutex);
+        cout << "UDP send offload not supported, sending datagrams one by one." << endl;
+    }
+
+    // 接收端不支持会话时无法重建目录,不发送数据直接断开
+    if (sessionMode && !sessionActive) {
+        {
+            lock_guard<mutex> lock(logMutex);
+            cout << "[Handshake] Receiver does not support session mode, cannot send a directory." << endl;
+        }
+        teardown();
+        return;
+    }
+
+    // 打包 (流模式、压缩或会话时只启动读线程,不等待读完)
+    streaming = streamMode || compressActive || sessionActive;
+    if (streaming) {
+        open_stream(filePath);
+    } else {
+        load_packets();
+    }
+
+    // 记录开始时间
+    startTime = chrono::steady_clock::now();
+    startUs = current_us();
+    stats.intervalUs = statsIntervalMs * 1000LL;
+    nextDumpUs = startUs + statsDumpMs * 1000LL;
+
+    // 启动 ACK 线程,当前线程作为发送线程
+    ackThread = thread(&SenderConnection::ack_receiver, this);
+    pin_current_thread(txCore < 0 ? -1 : txCore + 2 * id, "Transmit");
+
+    transmit();
+    endTime = chrono::steady_clock::now();
+    record_sample(true);
+
+    // 停止 ACK 线程,之后由发送线程自己接收挥手的 ACK
+    ackStop.store(true, memory_order_release);
+    ackLoop.notify();
+    ackThread.join();
+
+    if (readerThread.joinable()) readerThread.join();   // 读线程已读到末尾,等它退出后摘要才完整
+    teardown();
+    if (compressActive) {
+        length = compressor.rawBytes;
+    }
+    if (sessionActive) {
+        length = session.fileBytes;     // 只计文件内容,不含记录头
+    }
+    if (resumed) {
+        length = resumeMap.bytes;       // 只计本次实际发送的数据
+    }
+    ok = digestStatus >= 0;             // 摘要不一致说明接收端的数据已损坏,传输失败
+    dump_stats();
+}
+
+void SenderConnection::cleanup() {
+    delete cc;
+    cc = nullptr;
+    loop.close();
+    ackLoop.close();
+    if (sock != INVALID_SOCKET) closesocket(sock);
+    sock = INVALID_SOCKET;
+}
+
+int main(int argc, char* argv[]) {
+    srand(time(0)); // 初始化随机种子
+
+    // 以 "--" 开头的是选项,其余按顺序作为位置参数
+    vector<string> args;
+    for (int i = 1; i < argc; i++) {
+        string opt = argv[i];
+        if (opt == "--mmap") {
+            useMmap = true;                     // 使用内存映射 + 分散/聚集发送,内存占用与文件大小无关
+        } else if (opt == "--stream") {
+            streamMode = true;                  // 按流读取 (管道等),内存占用只与窗口大小有关
+        } else if (opt == "--mss" && i + 1 < argc) {
+            requestedMss = max(1, min(MAX_MSS, atoi(argv[++i])));    // 提议的分段大小,最终由接收端决定
+        } else if (opt == "--gso") {
+            useGso = true;                      // 一次系统调用发出多个分段,由协议栈切分
+        } else if (opt == "--pacing") {
+            usePacing = true;                   // 按速率均匀发送,与默认的突发发送对比丢包和有效吞吐
+        } else if (opt == "--pin" && i + 1 < argc) {
+            // 发送线程和 ACK 线程分别固定到的 CPU 核,格式为 "发送核,ACK核"
+            if (sscanf(argv[++i], "%d,%d", &txCore, &ackCore) < 1) {
+                txCore = ackCore = -1;
+            }
+        } else if (opt == "--cc" && i + 1 < argc) {
+            ccName = argv[++i];                 // reno / cubic / bbr
+        } else if (opt == "--streams" && i + 1 < argc) {
+            streamCount = max(1, atoi(argv[++i]));  // 条带数,接收端需要用同样的 --streams 监听连续的端口
+        } else if (opt == "--resume") {
+            useResume = true;                   // 接收端 (同样带 --resume) 保留了上次中断的进度时只发送缺失的部分
+        } else if (opt == "--compress") {
+            useCompress = true;                 // 压缩数据后再发送,适合文本和日志
+        } else if (opt == "--compress-threads" && i + 1 < argc) {
+            compressThreads = max(1, atoi(argv[++i]));
+        } else if (opt == "--fec" && i + 1 < argc) {
+            // 每 k 个数据包一个校验包;auto 按观测到的丢包率在 4..32 之间调整,丢包很少时不发校验包
+            string v = argv[++i];
+            fecBlock = v == "auto" ? -1 : max(0, min(atoi(v.c_str()), 65535));
+        } else if (opt == "--isn" && i + 1 < argc) {
+            isn = (uint32_t)strtoul(argv[++i], NULL, 0);    // 初始序列号,接收端从 SYN 中得知
+        } else if (opt == "--stats" && i + 1 < argc) {
+            statsPath = argv[++i];              // 计数器和时间序列的输出文件,.json 为类 qlog 格式,否则为 CSV
+        } else if (opt == "--stats-interval" && i + 1 < argc) {
+            statsIntervalMs = max(1, atoi(argv[++i]));
+        } else if (opt == "--stats-dump" && i + 1 < argc) {
+            statsDumpMs = max(0, atoi(argv[++i]));  // 传输过程中定期写文件,便于观察卡住的传输
+        } else {
+            args.push_back(opt);
+        }
+    }
+
+    if (args.size() < 3) {
+        cout << "Usage: " << argv[0] << " <server_ip> <server_port> <file_path> [loss_rate] [window_size] [delay_ms] [--mmap | --stream] [--mss bytes] [--gso] [--cc reno|cubic|bbr] [--pacing] [--pin tx_cpu,ack_cpu] [--streams n] [--isn n] [--resume]" << endl;
+        cout << "       [--compress] [--compress-threads n] [--fec k|auto] [--stats file.csv|file.json] [--stats-interval ms] [--stats-dump ms]" << endl;
+        cout << "       file_path \"-\" reads from stdin (implies --stream); a directory or @list_file sends many files in one session" << endl;
+        cout << "Example: " << argv[0] << " 127.0.0.1 8080 data.txt 0.1 20 100" << endl;
+        return 1;
+    }
+
+    CongestionControl* probe = create_congestion_control(ccName);
+    if (!probe) {
+        cerr << "Unknown congestion control: " << ccName << endl;
+        return 1;
+    }
+    cout << "Congestion control: " << probe->name() << (usePacing ? ", paced" : ", burst") << endl;
+    delete probe;
+
+    string serverIp = args[0];                  // 服务器 IP 地址
+    int serverPort = atoi(args[1].c_str());     // 服务器端口
+    string filePath = args[2];                  // 发送文件路径
+    if (filePath == "-") {
+        streamMode = true;                      // 标准输入只能按流读取
+    }
+    if (streamMode && streamCount > 1) {
+        cerr << "Striped transfer needs a file of known size, --streams cannot be used with --stream." << endl;
+        return 1;
+    }
+    sessionMode = !streamMode && (filePath[0] == '@' || is_directory(filePath));
+    if (sessionMode && streamCount > 1) {
+        cerr << "Session mode sends all files over one connection, --streams cannot be used with a directory or file list." << endl;
+        return 1;
+    }
+    if (useResume && (streamMode || sessionMode || useCompress)) {
+        cerr << "--resume needs a single file of known size sent uncompressed." << endl;
+        return 1;
+    }
+    if (args.size() >= 4) {                     // 可选参数:丢包率
+        packetLossRate = atof(args[3].c_str());
+        cout << "Packet Loss Rate set to: " << packetLossRate << endl;
+    }
+    if (args.size() >= 5) {                     // 可选参数:窗口大小
+        maxWindowSize = atoi(args[4].c_str());
+        cout << "Max Window Size set to: " << maxWindowSize << endl;
+    }
+    if (args.size() >= 6) {                     // 可选参数:延时
+        delayMs = atoi(args[5].c_str());
+        cout << "Delay set to: " << delayMs << " ms" << endl;
+        if (delayMs > 0) {
+            // 发送线程每个包 sleep 一次,测得的吞吐量主要由 sleep 决定;真实的时延/丢包用 impair_proxy 模拟
+            cout << "Note: the delay blocks the transmit thread for every packet. Use impair_proxy for realistic delay." << endl;
+        }
+    }
+
+    // 初始化 Winsock
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+
+    // 文件模式先读入 (或映射) 整个文件,才能按大小切分条带;会话模式只列出文件,由读线程逐个读取
+    if (sessionMode) {
+        load_session(filePath);
+        long long files = 0, bytes = 0;
+        for (const SessionFile& f : sessionFiles) {
+            if (f.directory) continue;
+            files++;
+            bytes += f.size;
+        }
+        cout << "Session: " << files << " files, " << bytes << " bytes." << endl;
+    } else if (!streamMode) {
+        load_file(filePath);
+    }
+
+    // 切分条带:每段 ceil(fileSize / streamCount) 字节并按 STRIPE_ALIGN 向上对齐,文件太小时后面的条带为空
+    long long stripeSize = (fileSize + streamCount - 1) / streamCount;
+    stripeSize = (stripeSize + STRIPE_ALIGN - 1) / STRIPE_ALIGN * STRIPE_ALIGN;
+    vector<unique_ptr<SenderConnection>> conns;
+    for (int i = 0; i < streamCount; i++) {
+        conns.push_back(unique_ptr<SenderConnection>(new SenderConnection()));
+        SenderConnection& c = *conns[i];
+        c.id = i;
+        c.offset = min(fileSize, i * stripeSize);
+        c.length = min(fileSize, c.offset + stripeSize) - c.offset;
+        if (!c.open(serverIp, serverPort + i)) {
+            cerr << "Failed to create event loop." << endl;
+            return 1;
+        }
+    }
+    if (streamCount > 1) {
+        cout << "Striped transfer: " << streamCount << " streams on ports " << serverPort << "-" << serverPort + streamCount - 1
+             << ", " << stripeSize << " bytes per stripe." << endl;
+    }
+
+    // 只有一个条带时直接在主线程中传输,否则每个条带一个线程
+    auto startTime = chrono::steady_clock::now();
+    if (streamCount == 1) {
+        conns[0]->run(filePath);
+    } else {
+        vector<thread> workers;
+        for (auto& c : conns) {
+            workers.push_back(thread(&SenderConnection::run, c.get(), filePath));
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+
+    // 汇总各条带的统计:总时间取最后一个条带完成的时间
+    bool allOk = true;
+    auto endTime = startTime;
+    long long totalBytes = 0;                   // 估算总传输数据量 (忽略重传的开销，计算有效吞吐率 Goodput)
+    long long retransmissions = 0;
+    long long dataPackets = 0, dataSyscalls = 0, ackPackets = 0, ackSyscalls = 0;
+    long long wireBytes = 0;                    // 实际发出的字节数 (含头部和重传)
+    long long fastRetransmits = 0, timeouts = 0, dupAcks = 0, checksumDrops = 0;
+    long long paritySent = 0, fecRecovered = 0;
+    long long payloadBytes = 0, compressBlocks = 0, storedBlocks = 0;     // 压缩后的字节流大小、块数和原样存放的块数
+    long long wakeups = 0, timerFires = 0;
+    int sessionSent = 0, sessionSkipped = 0;    // 会话中发送的文件数和无法打开而跳过的文件数
+    long long resumeSkipped = 0;                // 断点续传时接收端已有的字节数
+    int digestVerified = 0;                     // 接收端确认摘要一致的连接数
+    for (auto& c : conns) {
+        if (!c->ok) {
+            allOk = false;
+            continue;
+        }
+        endTime = max(endTime, c->endTime);
+        totalBytes += c->length;
+        retransmissions += c->retransmissions;
+        dataPackets += c->sendBatch.packets;
+        dataSyscalls += c->sendBatch.syscalls;
+        wireBytes += c->sendBatch.bytes;
+        fastRetransmits += c->fastRetransmits;
+        timeouts += c->timeouts;
+        dupAcks += c->dupAcks;
+        checksumDrops += c->checksumDrops.load();
+        paritySent += c->paritySent;
+        payloadBytes += c->compressActive ? c->compressor.outBytes : c->length;
+        compressBlocks += c->compressor.blocks;
+        storedBlocks += c->compressor.storedBlocks;
+        fecRecovered += c->peerRecovered;
+        sessionSent += c->session.filesSent;
+        resumeSkipped += c->resumeSkipped;
+        digestVerified += c->digestStatus > 0;
+        sessionSkipped += c->session.filesFailed;
+        ackPackets += c->ackBatch.packets;
+        ackSyscalls += c->ackBatch.syscalls;
+        wakeups += c->loop.wakeups;
+        timerFires += c->loop.timerFires;
+    }
+
+    if (allOk) {
+        auto totalTimeUs = chrono::duration_cast<chrono::microseconds>(endTime - startTime).count();
+        double totalTimeSec = totalTimeUs / 1000000.0;      // 除以一百万转换为秒(microseconds转为seconds)
+
+        // 计算吞吐率 (Bytes / Second) -> MB/s
+        double throughput = (double)totalBytes / 1024.0 / 1024.0 / totalTimeSec;        // MB/s
+
+        cout << endl << "Transfer Complete!" << endl;
+        if (streamCount > 1) {
+            for (auto& c : conns) {
+                double sec = chrono::duration_cast<chrono::microseconds>(c->endTime - c->startTime).count() / 1000000.0;
+                cout << "Stripe " << c->id << ": " << c->length << " bytes, " << sec << " s, "
+                     << (sec > 0 ? c->length / 1024.0 / 1024.0 / sec : 0.0) << " MB/s, "
+                     << c->retransmissions << " retransmissions" << endl;
+            }
+        }
+        cout << "Time: " << totalTimeSec << " s" << endl;
+        cout << "Throughput: " << throughput << " MB/s" << endl;
+        cout << "Retransmissions: " << retransmissions << " (fast " << fastRetransmits << ", " << timeouts << " timeout events)" << endl;
+        cout << "Duplicate ACKs: " << dupAcks << ", ACK checksum drops: " << checksumDrops << endl;
+        if (fecBlock != 0) {
+            cout << "FEC: " << paritySent << " parity packets, " << fecRecovered << " packets recovered by the receiver" << endl;
+        }
+        cout << "Wire: " << wireBytes << " bytes (" << wireBytes / 1024.0 / 1024.0 / totalTimeSec << " MB/s)" << endl;
+        if (useCompress) {
+            cout << "Compression: " << totalBytes << " logical bytes -> " << payloadBytes << " payload bytes (ratio "
+                 << (payloadBytes ? (double)totalBytes / payloadBytes : 0.0) << "), " << storedBlocks << " of "
+                 << compressBlocks << " blocks stored raw" << endl;
+        }
+        if (useResume) {
+            cout << "Resume: " << totalBytes << " bytes sent, " << resumeSkipped << " bytes already at the receiver" << endl;
+        }
+        if (sessionMode) {
+            cout << "Session: " << sessionSent << " files, " << totalBytes << " bytes over one connection";
+            if (sessionSkipped > 0) cout << ", " << sessionSkipped << " unreadable files skipped";
+            cout << endl;
+        }
+        const char* crcImpl;
+        select_crc32c(&crcImpl);
+        if (streamCount == 1) {
+            cout << "Digest: CRC32C " << digest_str(conns[0]->digest.value()) << " over " << conns[0]->digest.bytes << " bytes ("
+                 << crcImpl << "), " << (digestVerified ? "verified by the receiver" : "not verified, receiver reported no digest") << endl;
+        } else {
+            cout << "Digest: CRC32C (" << crcImpl << ") verified by the receiver on " << digestVerified << " of " << streamCount << " stripes" << endl;
+        }
+        cout << "Data: " << dataPackets << " packets in " << dataSyscalls << " send syscalls ("
+             << (dataSyscalls ? (double)dataPackets / dataSyscalls : 0.0) << " packets/syscall)" << endl;
+        cout << "ACK: " << ackPackets << " packets in " << ackSyscalls << " recv syscalls ("
+             << (ackSyscalls ? (double)ackPackets / ackSyscalls : 0.0) << " packets/syscall)" << endl;
+        cout << "Event loop: " << wakeups << " ACK wakeups, " << timerFires << " timer wakeups"
+             << (conns[0]->loop.highResolution ? " (high-resolution timer)" : "") << endl;
+        if (!statsPath.empty()) {
+            cout << "Stats written to " << statsPath << (streamCount > 1 ? " (one file per stripe)" : "") << endl;
+        }
+    } else {
+        cout << endl << "Transfer Failed!" << endl;
+    }
+
+    unload_file();
+    for (auto& c : conns) {
+        c->cleanup();
+    }
+    WSACleanup();
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,282 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+// 多文件会话 (握手时协商,见 FLAG_SESSION)
+// 一个连接依次传输多个文件:发送端把每个文件编码成 "记录头 + 相对路径 + 文件内容",首尾相接成一条字节流,
+// 空目录单独一个记录,最后是一个结束记录. 字节流像流模式一样切成满的分段发送,小文件之间没有任何往返,
+// 握手、挥手各一次,拥塞窗口在文件之间保持不变. 接收端按序解析字节流,在输出目录下重建目录树.
+// 路径以 / 分隔 (Windows 的文件 API 同样接受 /).
+
+const uint32_t SESSION_MAGIC = 0x53534452;  // "RDSS",用于发现字节流错位
+const uint16_t SESSION_FILE = 1;            // 记录之后是路径和文件内容
+const uint16_t SESSION_END = 2;             // 会话结束,之后没有数据
+const uint16_t SESSION_DIR = 3;             // 空目录,记录之后只有路径
+
+#pragma pack(push, 1)
+struct SessionRecord {
+    uint32_t magic;
+    uint16_t type;
+    uint16_t pathLength;    // 之后的相对路径长度 (不含结尾的 0)
+    uint64_t size;          // 文件大小
+};
+#pragma pack(pop)
+
+struct SessionFile {
+    std::string path;       // 本地路径
+    std::string name;       // 发给接收端的相对路径
+    uint64_t size;
+    bool directory;         // 空目录 (有文件的目录由文件路径隐含)
+};
+
+inline bool is_directory(const std::string& path) {
+    DWORD attr = GetFileAttributesA(path.c_str());
+    return attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+// 递归列出目录下的所有文件,prefix 为相对路径前缀
+inline void list_files(const std::string& dir, const std::string& prefix, std::vector<SessionFile>& out) {
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA((dir + "/*").c_str(), &fd);
+    if (h == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    std::vector<SessionFile> files;
+    std::vector<std::string> dirs;
+    do {
+        std::string n = fd.cFileName;
+        if (n == "." || n == "..") continue;
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            dirs.push_back(n);
+        } else {
+            files.push_back({dir + "/" + n, prefix + n, ((uint64_t)fd.nFileSizeHigh << 32) | fd.nFileSizeLow, false});
+        }
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
+    if (files.empty() && dirs.empty() && !prefix.empty()) {
+        out.push_back({dir, prefix.substr(0, prefix.size() - 1), 0, true});
+        return;
+    }
+    // 按名称排序,两次传输同一目录时顺序相同
+    std::sort(files.begin(), files.end(), [](const SessionFile& a, const SessionFile& b) { return a.name < b.name; });
+    std::sort(dirs.begin(), dirs.end());
+    out.insert(out.end(), files.begin(), files.end());
+    for (const std::string& d : dirs) {
+        list_files(dir + "/" + d, prefix + d + "/", out);
+    }
+}
+
+// 发送端:按文件列表产生会话字节流,read() 像 fread 一样除最后一次外总是读满
+class SessionSource {
+public:
+    long long fileBytes = 0;        // 已读出的文件内容字节数
+    int filesSent = 0;              // 已开始发送的文件数
+    int filesFailed = 0;            // 无法打开而跳过的文件数
+
+    void start(const std::vector<SessionFile>& list) {
+        files = list;
+    }
+
+    size_t read(char* buf, size_t n) {
+        size_t done = 0;
+        while (done < n) {
+            if (headerPos < header.size()) {
+                size_t k = std::min(n - done, header.size() - headerPos);
+                memcpy(buf + done, header.data() + headerPos, k);
+                headerPos += k;
+                done += k;
+            } else if (cur) {
+                size_t want = (size_t)std::min((uint64_t)(n - done), remaining);
+                size_t k = fread(buf + done, 1, want, cur);
+                if (k == 0) {
+                    // 文件在列出之后变短了:用 0 补足记录头中的大小,后面的记录才不会错位
+                    k = want;
+                    memset(buf + done, 0, k);
+                }
+                remaining -= k;
+                done += k;
+                fileBytes += k;
+                if (remaining == 0) {
+                    fclose(cur);
+                    cur = nullptr;
+                }
+            } else if (ended) {
+                break;
+            } else {
+                next_record();
+            }
+        }
+        return done;
+    }
+
+private:
+    std::vector<SessionFile> files;
+    size_t next = 0;                // 下一个文件
+    std::vector<char> header;       // 当前的记录头和路径
+    size_t headerPos = 0;
+    FILE* cur = nullptr;            // 正在读的文件
+    uint64_t remaining = 0;         // 当前文件还没读出的字节数
+    bool ended = false;             // 结束记录已经放入 header
+
+    void set_header(uint16_t type, const std::string& name, uint64_t size) {
+        SessionRecord rec;
+        rec.magic = SESSION_MAGIC;
+        rec.type = type;
+        rec.pathLength = (uint16_t)name.size();
+        rec.size = size;
+        header.assign((const char*)&rec, (const char*)&rec + sizeof(rec));
+        header.insert(header.end(), name.begin(), name.end());
+        headerPos = 0;
+    }
+
+    void next_record() {
+        while (next < files.size()) {
+            const SessionFile& f = files[next++];
+            if (f.directory) {
+                set_header(SESSION_DIR, f.name, 0);
+                return;
+            }
+            cur = fopen(f.path.c_str(), "rb");
+            if (!cur || f.name.size() > 0xFFFF) {
+                if (cur) fclose(cur);
+                cur = nullptr;
+                filesFailed++;
+                continue;
+            }
+            set_header(SESSION_FILE, f.name, f.size);
+            remaining = f.size;
+            filesSent++;
+            if (remaining == 0) {
+                fclose(cur);
+                cur = nullptr;
+            }
+            return;
+        }
+        set_header(SESSION_END, "", 0);
+        ended = true;
+    }
+};
+
+// 接收端:按序解析会话字节流,在 root 目录下创建文件;路径不合法 (绝对路径或含 ..) 时停止
+class SessionWriter {
+public:
+    long long files = 0;            // 已创建的文件数
+    long long bytes = 0;            // 写入的文件内容字节数
+    bool finished = false;          // 收到了结束记录
+    bool failed = false;
+    std::string error;
+
+    bool start(const std::string& dir) {
+        root = dir;
+        CreateDirectoryA(root.c_str(), NULL);
+        return is_directory(root);
+    }
+
+    void feed(const char* data, int len) {
+        while (len > 0 && !failed && !finished) {
+            if (remaining > 0) {
+                int k = (int)std::min((uint64_t)len, remaining);
+                out.write(data, k);
+                remaining -= k;
+                bytes += k;
+                data += k;
+                len -= k;
+                if (remaining == 0) {
+                    out.close();
+                }
+                continue;
+            }
+            // 凑齐记录头,再凑齐路径
+            size_t need = sizeof(SessionRecord);
+            if (pending.size() >= sizeof(SessionRecord)) {
+                need += ((const SessionRecord*)pending.data())->pathLength;
+            }
+            int k = (int)std::min((size_t)len, need - pending.size());
+            pending.insert(pending.end(), data, data + k);
+            data += k;
+            len -= k;
+            if (pending.size() == sizeof(SessionRecord)) {
+                const SessionRecord* rec = (const SessionRecord*)pending.data();
+                if (rec->magic != SESSION_MAGIC) {
+                    fail("bad record header");
+                    return;
+                }
+            }
+            if (pending.size() >= sizeof(SessionRecord) &&
+                pending.size() == sizeof(SessionRecord) + ((const SessionRecord*)pending.data())->pathLength) {
+                begin_file();
+            }
+        }
+    }
+
+private:
+    std::string root;
+    std::vector<char> pending;      // 还没凑齐的记录头和路径
+    std::ofstream out;
+    uint64_t remaining = 0;         // 当前文件还没收到的字节数
+
+    void fail(const std::string& why) {
+        failed = true;
+        error = why;
+        if (out.is_open()) out.close();
+    }
+
+    // 只接受相对路径,且不能含 .. (不能写到 root 之外)
+    static bool safe_path(const std::string& name) {
+        if (name.empty() || name[0] == '/' || name[0] == '\\' || name.find(':') != std::string::npos) {
+            return false;
+        }
+        size_t start = 0;
+        while (start <= name.size()) {
+            size_t end = name.find_first_of("/\\", start);
+            if (end == std::string::npos) end = name.size();
+            std::string part = name.substr(start, end - start);
+            if (part.empty() || part == "..") return false;
+            start = end + 1;
+        }
+        return true;
+    }
+
+    void begin_file() {
+        SessionRecord rec;
+        memcpy(&rec, pending.data(), sizeof(rec));
+        std::string name(pending.begin() + sizeof(SessionRecord), pending.end());
+        pending.clear();
+        if (rec.type == SESSION_END) {
+            finished = true;
+            return;
+        }
+        if ((rec.type != SESSION_FILE && rec.type != SESSION_DIR) || !safe_path(name)) {
+            fail("rejected path: " + name);
+            return;
+        }
+        // 逐级创建父目录
+        for (size_t pos = name.find_first_of("/\\"); pos != std::string::npos; pos = name.find_first_of("/\\", pos + 1)) {
+            CreateDirectoryA((root + "/" + name.substr(0, pos)).c_str(), NULL);
+        }
+        if (rec.type == SESSION_DIR) {
+            CreateDirectoryA((root + "/" + name).c_str(), NULL);
+            return;
+        }
+        out.open(root + "/" + name, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            fail("cannot create " + name);
+            return;
+        }
+        files++;
+        remaining = rec.size;
+        if (remaining == 0) {
+            out.close();
+        }
+    }
+};
+
+#endif // SESSION_H
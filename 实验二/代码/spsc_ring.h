@@ -0,0 +1,48 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+
+// 单生产者单消费者的无锁环形队列
+// 生产者只写 tail,消费者只写 head,两边各自缓存对方的位置,只有看起来满/空时才重新读取对方的原子变量,
+// 大部分操作不产生跨核的缓存行争用. N 必须是 2 的幂.
+template <typename T, size_t N>
+class SpscRing {
+    static_assert((N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    // 生产者调用,队列满时返回 false
+    bool push(const T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - headCache_ == N) {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (tail - headCache_ == N) return false;
+        }
+        items_[tail & (N - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);      // 发布:消费者看到新的 tail 时数据已经写好
+        return true;
+    }
+
+    // 消费者调用,队列空时返回 false
+    bool pop(T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tailCache_) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head == tailCache_) return false;
+        }
+        item = items_[head & (N - 1)];
+        head_.store(head + 1, std::memory_order_release);      // 归还槽位
+        return true;
+    }
+
+private:
+    // 两端的变量放在不同的缓存行上,避免伪共享
+    alignas(64) std::atomic<size_t> head_{0};     // 消费者位置
+    size_t tailCache_ = 0;                        // 消费者缓存的 tail
+    alignas(64) std::atomic<size_t> tail_{0};     // 生产者位置
+    size_t headCache_ = 0;                        // 生产者缓存的 head
+    alignas(64) T items_[N];
+};
+
+#endif // SPSC_RING_H
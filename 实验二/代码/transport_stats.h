@@ -0,0 +1,126 @@
+#ifndef TRANSPORT_STATS_H
+#define TRANSPORT_STATS_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <utility>
+
+// 传输统计
+// 计数器由各线程在关键路径上直接累加 (只是整数加一),结束时或定期连同时间序列一起写到文件.
+// 时间序列按固定间隔采样拥塞控制状态,拥塞事件 (进入快速恢复/超时) 时额外采一次,
+// 这样 cwnd 的每次下降都能看到,又不必每个 ACK 都记录.
+// 文件名以 .json 结尾时写成类似 qlog 的 JSON (每个样本一个 recovery:metrics_updated 事件),否则写 CSV.
+
+typedef std::vector<std::pair<std::string, long long>> StatsCounters;   // 名称 -> 值,按输出顺序排列
+
+// 一个时间序列样本
+struct StatsSample {
+    long long timeUs;               // 距传输开始的时间
+    double cwnd;                    // 拥塞窗口 (包)
+    double ssthresh;                // 慢启动阈值 (包)
+    const char* state;              // 拥塞控制状态
+    long long inflight;             // 在途的包数
+    long long rwnd;                 // 接收端通告的窗口 (从窗口左边界算起的包数),-1 表示接收端不通告
+    double srttUs;                  // 平滑 RTT
+    long long latestRttUs;          // 最近一个 RTT 样本,没有时为 -1
+    long long rtoUs;                // 当前重传超时
+    long long delivered;            // 累计确认的包数
+    long long retransmits;          // 累计重传次数
+};
+
+struct StatsRecorder {
+    long long intervalUs = 10000;   // 采样间隔
+    long long nextSampleUs = 0;
+    std::vector<StatsSample> samples;
+
+    // 到了采样时间返回 true (force 时总是采样)
+    bool due(long long nowUs, bool force = false) {
+        if (!force && nowUs < nextSampleUs) {
+            return false;
+        }
+        nextSampleUs = nowUs + intervalUs;
+        return true;
+    }
+
+    void add(const StatsSample& s) {
+        samples.push_back(s);
+    }
+};
+
+// CSV:开头几行以 # 开头的计数器,之后是时间序列表格
+inline bool write_stats_csv(const std::string& path, const StatsCounters& counters, const std::vector<StatsSample>& samples) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    for (const auto& c : counters) {
+        out << "# " << c.first << "," << c.second << "\n";
+    }
+    if (samples.empty()) {
+        return (bool)out;               // 接收端只有计数器
+    }
+    out << "time_ms,cwnd,ssthresh,state,inflight,rwnd,srtt_ms,latest_rtt_ms,rto_ms,delivered,retransmits\n";
+    for (const auto& s : samples) {
+        out << s.timeUs / 1000.0 << "," << s.cwnd << "," << s.ssthresh << "," << s.state << "," << s.inflight << "," << s.rwnd << ","
+            << s.srttUs / 1000.0 << "," << (s.latestRttUs < 0 ? -1.0 : s.latestRttUs / 1000.0) << ","
+            << s.rtoUs / 1000.0 << "," << s.delivered << "," << s.retransmits << "\n";
+    }
+    return (bool)out;
+}
+
+// 类似 qlog 的 JSON:计数器放在 trace 的 summary 中,样本作为 recovery:metrics_updated 事件 (时间单位为毫秒)
+// vantage: "client" (发送端) 或 "server" (接收端)
+inline bool write_stats_json(const std::string& path, const std::string& title, const char* vantage,
+                             const StatsCounters& counters, const std::vector<StatsSample>& samples) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << "{\n  \"qlog_version\": \"0.3\",\n  \"title\": \"" << title << "\",\n  \"traces\": [{\n";
+    out << "    \"vantage_point\": {\"type\": \"" << vantage << "\"},\n";
+    out << "    \"common_fields\": {\"time_format\": \"relative\"},\n";
+    out << "    \"summary\": {";
+    for (size_t i = 0; i < counters.size(); i++) {
+        out << (i ? ", " : "") << "\"" << counters[i].first << "\": " << counters[i].second;
+    }
+    out << "},\n    \"events\": [\n";
+    for (size_t i = 0; i < samples.size(); i++) {
+        const StatsSample& s = samples[i];
+        out << "      {\"time\": " << s.timeUs / 1000.0 << ", \"name\": \"recovery:metrics_updated\", \"data\": {"
+            << "\"congestion_window\": " << s.cwnd << ", \"ssthresh\": " << s.ssthresh
+            << ", \"congestion_state\": \"" << s.state << "\", \"packets_in_flight\": " << s.inflight
+            << ", \"receive_window\": " << s.rwnd
+            << ", \"smoothed_rtt\": " << s.srttUs / 1000.0;
+        if (s.latestRttUs >= 0) {
+            out << ", \"latest_rtt\": " << s.latestRttUs / 1000.0;
+        }
+        out << ", \"rto\": " << s.rtoUs / 1000.0 << ", \"delivered\": " << s.delivered
+            << ", \"retransmits\": " << s.retransmits << "}}" << (i + 1 < samples.size() ? "," : "") << "\n";
+    }
+    out << "    ]\n  }]\n}\n";
+    return (bool)out;
+}
+
+inline bool write_stats(const std::string& path, const std::string& title, const char* vantage,
+                        const StatsCounters& counters, const std::vector<StatsSample>& samples) {
+    if (path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0) {
+        return write_stats_json(path, title, vantage, counters, samples);
+    }
+    return write_stats_csv(path, counters, samples);
+}
+
+// 条带传输时每个连接写各自的文件:在扩展名前插入 .<编号>
+inline std::string stats_path(const std::string& path, int id, int count) {
+    if (count <= 1) {
+        return path;
+    }
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return path + "." + std::to_string(id);
+    }
+    return path.substr(0, dot) + "." + std::to_string(id) + path.substr(dot);
+}
+
+#endif // TRANSPORT_STATS_H
@@ -0,0 +1,243 @@
+#ifndef UDP_BATCH_H
+#define UDP_BATCH_H
+
+#include "rdt.h"
+#include <mswsock.h>                // WSARecvMsg
+
+// UDP 批量收发层
+// 发送端把一轮要发的数据报先攒在 UdpSendBatch 中,最后一次性 flush;
+// 接收端用 UdpRecvBatch 一次取走套接字中已经到达的所有数据报,而不是每个包都先 select 再 recvfrom.
+// Winsock 没有 sendmmsg/recvmmsg,所以默认情况下 flush 仍然是每个数据报一次 WSASendTo.
+// 启用 UDP 分段卸载 (USO/URO,Windows 上对应 Linux 的 GSO/GRO) 后,一次系统调用可以搬运最多 64 KB、几十个数据报.
+
+// 旧版 SDK / MinGW 头文件中可能没有这些常量 (定义见 ws2ipdef.h)
+#ifndef UDP_SEND_MSG_SIZE
+#define UDP_SEND_MSG_SIZE 2
+#endif
+#ifndef UDP_RECV_MAX_COALESCED_SIZE
+#define UDP_RECV_MAX_COALESCED_SIZE 3
+#endif
+#ifndef UDP_COALESCED_INFO
+#define UDP_COALESCED_INFO 3
+#endif
+
+const int UDP_OFFLOAD_MAX_BYTES = 65000;   // 一次分段卸载发送/接收的最大字节数 (UDP 长度字段上限 64 KB)
+
+// 把套接字设为非阻塞,批量接收依靠 WSAEWOULDBLOCK 判断已经取空
+inline void set_nonblocking(SOCKET s) {
+    u_long mode = 1;
+    ioctlsocket(s, FIONBIO, &mode);
+}
+
+struct UdpSendBatch {
+    static const int MAX_BATCH = 64;        // 一批最多攒多少个数据报,满了自动 flush
+
+    struct Entry {
+        PacketHeader header;                // 头部 (拷贝,20 字节)
+        const char* data;                   // 数据部分,不拷贝,flush 之前必须保持有效
+        sockaddr_in to;                     // 目的地址
+    };
+
+    SOCKET sock = INVALID_SOCKET;
+    Entry entries[MAX_BATCH];
+    int count = 0;
+    int usoSegment = 0;                     // 大于 0 表示已启用 USO,值为每个数据报的字节数 (头部 + 分段大小)
+
+    long long packets = 0;                  // 统计:发出的数据报数
+    long long syscalls = 0;                 // 统计:发送系统调用次数
+    long long bytes = 0;                    // 统计:发出的字节数 (含头部,不含 IP/UDP 头)
+
+    void init(SOCKET s) { sock = s; }
+
+    // 启用 UDP 发送分段卸载:一次 WSASendTo 交给内核多个首尾相接的数据报,由协议栈/网卡按 segBytes 切开
+    // 系统不支持时返回 false,此时仍逐个发送
+    bool enable_uso(int segBytes) {
+        DWORD size = segBytes;
+        if (setsockopt(sock, IPPROTO_UDP, UDP_SEND_MSG_SIZE, (char*)&size, sizeof(size)) != 0) {
+            return false;
+        }
+        usoSegment = segBytes;
+        return true;
+    }
+
+    // 加入一个数据报,头部中的校验和应当已经填好
+    void add(const PacketHeader& header, const char* data, const sockaddr_in& to) {
+        if (count == MAX_BATCH) {
+            flush();
+        }
+        Entry& e = entries[count++];
+        e.header = header;
+        e.data = data;
+        e.to = to;
+        bytes += sizeof(PacketHeader) + header.length;
+    }
+
+    int entry_bytes(int i) const { return sizeof(PacketHeader) + entries[i].header.length; }
+
+    bool same_dest(int i, int j) const {
+        return entries[i].to.sin_addr.s_addr == entries[j].to.sin_addr.s_addr && entries[i].to.sin_port == entries[j].to.sin_port;
+    }
+
+    // 把 entries[first, last) 作为一次 WSASendTo 发出 (多于一个时依赖 USO 切分)
+    void send_group(int first, int last) {
+        WSABUF bufs[2 * MAX_BATCH];
+        DWORD n = 0;
+        for (int i = first; i < last; i++) {
+            bufs[n].buf = (char*)&entries[i].header;
+            bufs[n].len = sizeof(PacketHeader);
+            n++;
+            if (entries[i].header.length > 0) {
+                bufs[n].buf = (char*)entries[i].data;
+                bufs[n].len = entries[i].header.length;
+                n++;
+            }
+        }
+        DWORD bytesSent = 0;
+        WSASendTo(sock, bufs, n, &bytesSent, 0, (sockaddr*)&entries[first].to, sizeof(sockaddr_in), NULL, NULL);
+        syscalls++;
+    }
+
+    // 发出所有攒下的数据报
+    // 启用 USO 时,把发往同一地址、除最后一个外长度都等于 usoSegment 的连续数据报合并成一次发送
+    void flush() {
+        int i = 0;
+        while (i < count) {
+            int j = i + 1;
+            if (usoSegment > 0) {
+                int total = entry_bytes(i);
+                while (j < count && entry_bytes(j - 1) == usoSegment && entry_bytes(j) <= usoSegment &&
+                       same_dest(i, j) && total + entry_bytes(j) <= UDP_OFFLOAD_MAX_BYTES) {
+                    total += entry_bytes(j);
+                    j++;
+                }
+            }
+            send_group(i, j);
+            i = j;
+        }
+        packets += count;
+        count = 0;
+    }
+};
+
+struct UdpRecvBatch {
+    long long packets = 0;                  // 统计:收到的数据报数
+    long long syscalls = 0;                 // 统计:接收相关的系统调用次数 (含 select)
+
+    // UDP 接收合并 (URO):协议栈把同一来源的多个数据报合并成一次接收,控制信息中给出原来每个数据报的长度
+    LPFN_WSARECVMSG recvMsg = nullptr;      // 启用 URO 后通过 WSARecvMsg 接收,才能拿到控制信息
+    std::vector<char> coalesced;            // 合并接收缓冲区
+    int coalescedLen = 0;                   // 合并缓冲区中的数据长度
+    int coalescedPos = 0;                   // 已经分发到的位置 (调用者的缓冲区不够时,剩下的留到下次)
+    int coalescedSeg = 0;                   // 每个数据报的长度 (最后一个可能更短)
+    sockaddr_in coalescedFrom;
+
+    // 启用 URO,系统不支持时返回 false,此时仍逐个接收
+    bool enable_uro(SOCKET s) {
+        GUID guid = WSAID_WSARECVMSG;
+        DWORD bytes = 0;
+        if (WSAIoctl(s, SIO_GET_EXTENSION_FUNCTION_POINTER, &guid, sizeof(guid), &recvMsg, sizeof(recvMsg), &bytes, NULL, NULL) != 0) {
+            recvMsg = nullptr;
+            return false;
+        }
+        DWORD maxSize = UDP_OFFLOAD_MAX_BYTES;
+        if (setsockopt(s, IPPROTO_UDP, UDP_RECV_MAX_COALESCED_SIZE, (char*)&maxSize, sizeof(maxSize)) != 0) {
+            recvMsg = nullptr;
+            return false;
+        }
+        coalesced.resize(UDP_OFFLOAD_MAX_BYTES);
+        return true;
+    }
+
+    // 用 WSARecvMsg 收一次 (可能是多个数据报合并而成),成功时返回字节数并设置 coalescedSeg
+    int recv_coalesced(SOCKET s) {
+        WSABUF data;
+        data.buf = coalesced.data();
+        data.len = (ULONG)coalesced.size();
+        char control[WSA_CMSG_SPACE(sizeof(DWORD))];
+        WSAMSG msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.name = (sockaddr*)&coalescedFrom;
+        msg.namelen = sizeof(coalescedFrom);
+        msg.lpBuffers = &data;
+        msg.dwBufferCount = 1;
+        msg.Control.buf = control;
+        msg.Control.len = sizeof(control);
+
+        DWORD received = 0;
+        if (recvMsg(s, &msg, &received, NULL, NULL) == SOCKET_ERROR) {
+            return SOCKET_ERROR;
+        }
+        coalescedSeg = received;            // 没有控制信息说明这次只收到一个数据报
+        for (WSACMSGHDR* c = WSA_CMSG_FIRSTHDR(&msg); c != NULL; c = WSA_CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level == IPPROTO_UDP && c->cmsg_type == UDP_COALESCED_INFO) {
+                coalescedSeg = *(DWORD*)WSA_CMSG_DATA(c);
+            }
+        }
+        coalescedLen = received;
+        coalescedPos = 0;
+        return received;
+    }
+
+    // 把合并缓冲区中剩余的数据报逐个拷贝到调用者的缓冲区,返回新的 n
+    int drain_coalesced(Packet** bufs, sockaddr_in* from, int* lens, int n, int max, int bufSize) {
+        while (n < max && coalescedPos < coalescedLen) {
+            int seg = std::min(coalescedSeg, coalescedLen - coalescedPos);
+            if (seg > 0 && seg <= bufSize) {
+                memcpy(bufs[n], coalesced.data() + coalescedPos, seg);
+                from[n] = coalescedFrom;
+                lens[n++] = seg;
+            }
+            coalescedPos += seg > 0 ? seg : 1;
+        }
+        return n;
+    }
+
+    // 收取最多 max 个数据报,第 i 个放入 bufs[i] (容量 bufSize 字节),来源地址放入 from[i],长度放入 lens[i],返回收到的个数.
+    // 套接字中暂时没有数据时最多等待 timeoutUs 微秒 (小于 0 表示一直等,等于 0 表示不等待),超时返回 0.
+    int recv(SOCKET s, Packet** bufs, sockaddr_in* from, int* lens, int max, int bufSize, long timeoutUs) {
+        int n = drain_coalesced(bufs, from, lens, 0, max, bufSize);
+        int errors = 0;
+        bool waited = false;
+        while (n < max && errors < max) {
+            int len;
+            if (recvMsg) {
+                len = recv_coalesced(s);
+                syscalls++;
+                if (len > 0) {
+                    n = drain_coalesced(bufs, from, lens, n, max, bufSize);
+                    continue;
+                }
+            } else {
+                int fromLen = sizeof(sockaddr_in);
+                len = recvfrom(s, (char*)bufs[n], bufSize, 0, (sockaddr*)&from[n], &fromLen);
+                syscalls++;
+                if (len > 0) {
+                    lens[n++] = len;
+                    continue;
+                }
+            }
+            if (len == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK) {
+                errors++;
+                continue;                   // 其他错误 (如 ICMP 端口不可达) 跳过这个数据报
+            }
+            // 已经取空:收到了包就返回,否则等待一次
+            if (n > 0 || waited || timeoutUs == 0) {
+                break;
+            }
+            fd_set readfds;
+            FD_ZERO(&readfds);
+            FD_SET(s, &readfds);
+            timeval tv = {timeoutUs / 1000000, timeoutUs % 1000000};
+            int ret = select(0, &readfds, NULL, NULL, timeoutUs < 0 ? NULL : &tv);
+            syscalls++;
+            if (ret <= 0) {
+                break;
+            }
+            waited = true;
+        }
+        packets += n;
+        return n;
+    }
+};
+
+#endif // UDP_BATCH_H